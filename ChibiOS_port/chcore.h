@@ -21,7 +21,9 @@
 #ifndef _CHCORE_H_
 #define _CHCORE_H_
 
+#if !defined(ARM_ENABLE_WFI_IDLE)
 #define ARM_ENABLE_WFI_IDLE             FALSE
+#endif
 
 #define CH_ARCHITECTURE_ARM
 #define CH_ARCHITECTURE_NAME            "CortexA"
@@ -104,10 +106,13 @@ struct context {
  * @details This size depends on the idle thread implementation, usually
  *          the idle thread should take no more space than those reserved
  *          by @p PORT_INT_REQUIRED_STACK.
- * @note    In this port it is set to 4 because the idle thread does have
- *          a stack frame when compiling without optimizations.
+ * @note    In this port the idle thread runs systickIdle() (wfi.h), and
+ *          the switch away from it runs THREAD_CONTEXT_SWITCH_HOOK
+ *          (threadStatsSwitch(), vfpSwitch()) on this stack on top of the
+ *          extctx, under chSchDoReschedule(). 0x100 covers both with room
+ *          for an unoptimised build.
  */
-#define PORT_IDLE_THREAD_STACK_SIZE     16
+#define PORT_IDLE_THREAD_STACK_SIZE     0x100
 
 /**
  * @brief   Per-thread stack overhead for interrupts servicing.
@@ -116,10 +121,16 @@ struct context {
  *          This value can be zero on those architecture where there is a
  *          separate interrupt stack and the stack space between @p intctx and
  *          @p extctx is known to be zero.
- * @note    In this port 0x10 is a safe value, it can be reduced after careful
- *          analysis of the generated code.
+ * @note    In this port ISRs run on the interrupted thread's stack and nest
+ *          by priority (_irq_eh in start.S), so every thread needs room for
+ *          one ISR per priority level in use: PORT_ISR_LEVELS of
+ *          PORT_ISR_LEVEL_STACK each. A level is the saved MODE_SYS lr, the
+ *          dbg_check spill and the deepest ISR call chain (EDMA completion
+ *          into I-class APIs, LOG(), tracing) with room for -O0.
  */
-#define PORT_INT_REQUIRED_STACK         0x10
+#define PORT_ISR_LEVELS                 3   /* HIGH, DEFAULT, LOW */
+#define PORT_ISR_LEVEL_STACK            0x100
+#define PORT_INT_REQUIRED_STACK         (PORT_ISR_LEVELS * PORT_ISR_LEVEL_STACK)
 
 /**
  * @brief   Enforces a correct alignment for a stack area size value.
@@ -166,9 +177,10 @@ struct context {
  * @brief   Fast IRQ handler function declaration.
  * @note    @p id can be a function name or a vector number depending on the
  *          port implementation.
+ * @note    In this port it is a plain function for hwInstallFastIRQ(), called
+ *          from _irq_eh on the IRQ stack. No kernel APIs may be used from it.
  */
-#define PORT_FAST_IRQ_HANDLER(id)                                           \
-                             __attribute__((interrupt("FIQ"))) void id(void)
+#define PORT_FAST_IRQ_HANDLER(id) void id(void)
 
 /**
  * @brief   Port-related initialization code.
@@ -198,18 +210,22 @@ struct context {
  * @details This function is invoked before invoking I-class APIs from
  *          interrupt handlers. The implementation is architecture dependent,
  *          in its simplest form it is void.
- * @note    Empty in this port.
+ * @note    In this port ISRs run in SYS mode with IRQs enabled so higher
+ *          priorities can preempt them (see _irq_eh). Only the I bit is
+ *          touched, the mode is left alone: the dbg_check_*_isr() calls use
+ *          this too.
  */
-#define port_lock_from_isr()
+#define port_lock_from_isr() asm volatile ("cpsid   i" : : : "memory")
 
 /**
  * @brief   Kernel-unlock action from an interrupt handler.
  * @details This function is invoked after invoking I-class APIs from interrupt
  *          handlers. The implementation is architecture dependent, in its
  *          simplest form it is void.
- * @note    Empty in this port.
+ * @note    In this port it unmasks IRQs, back to a preemptible ISR, in
+ *          whatever mode it was called from.
  */
-#define port_unlock_from_isr()
+#define port_unlock_from_isr() asm volatile ("cpsie   i" : : : "memory")
 
 /**
  * @brief   Disables all the interrupt sources.
@@ -262,7 +278,11 @@ struct context {
 #define port_switch(ntp, otp) _port_switch_arm(ntp, otp)
 #endif
 
+#if ARM_ENABLE_WFI_IDLE
+#include "wfi.h"
+#else
 #define port_wait_for_interrupt() { }
+#endif
 
   void port_halt(void);
   void _port_switch_arm(Thread *ntp, Thread *otp);
@@ -266,6 +266,19 @@
 #define CM_CLKSEL_WDT1_CLK          HWREG32(CM_CLKSEL_BASE_ADDR + 0x38)
 #define CM_CLKSEL_GPIO0_DBCLK       HWREG32(CM_CLKSEL_BASE_ADDR + 0x3C)
 
+/******************** PRM_DEVICE (RESET) *************************************/
+#define PRM_DEVICE_BASE_ADDR 0x44E00F00
+#define PRM_RSTCTRL     HWREG32(PRM_DEVICE_BASE_ADDR + 0x00)
+#define PRM_RSTTIME     HWREG32(PRM_DEVICE_BASE_ADDR + 0x04)
+#define PRM_RSTST       HWREG32(PRM_DEVICE_BASE_ADDR + 0x08)
+
+/* PRM_RSTST, write 1 to clear */
+#define PRM_RSTST_ICEPICK_RST           BIT_9
+#define PRM_RSTST_EXTERNAL_WARM_RST     BIT_5
+#define PRM_RSTST_WDT1_RST              BIT_4
+#define PRM_RSTST_GLOBAL_WARM_SW_RST    BIT_1
+#define PRM_RSTST_GLOBAL_COLD_RST       BIT_0
+
 
 /******************** CONTROL MODULE *****************************************/
 #define CTRLM_BASE_ADDR 0x44E10000
@@ -823,6 +836,30 @@
 #define UART_LCR_NB_STOP           BIT_2
 #define UART_LCR_CHAR_LENGTH(val) ((val) & 0x3)
 
+#define UART_IER_CTS_IT             BIT_7
+#define UART_IER_RTS_IT             BIT_6
+#define UART_IER_XOFF_IT            BIT_5
+#define UART_IER_SLEEP_MODE         BIT_4
+#define UART_IER_MODEM_STS_IT       BIT_3
+#define UART_IER_LINE_STS_IT        BIT_2
+#define UART_IER_THR_IT             BIT_1
+#define UART_IER_RHR_IT             BIT_0
+
+#define UART_IIR_FCR_MIRROR_MASK    (BIT_7 | BIT_6)
+#define UART_IIR_IT_TYPE_MASK       0x3E
+#define UART_IIR_IT_TYPE_SHFT       1
+#define UART_IIR_IT_PENDING         BIT_0   /* 0 when an interrupt is pending */
+
+enum {
+    UART_IIR_IT_TYPE_MODEM   = 0x00,
+    UART_IIR_IT_TYPE_THR     = 0x01,
+    UART_IIR_IT_TYPE_RHR     = 0x02,
+    UART_IIR_IT_TYPE_LINE    = 0x03,
+    UART_IIR_IT_TYPE_RX_TO   = 0x06,
+    UART_IIR_IT_TYPE_XOFF    = 0x08,
+    UART_IIR_IT_TYPE_CTS_RTS = 0x10,
+};
+
 #define UART_LSR_RXFIFOSTS          BIT_7
 #define UART_LSR_TXSRE              BIT_6
 #define UART_LSR_TXFIFOE            BIT_5
@@ -854,6 +891,13 @@
 
 #define UART_SCR_RX_TRIG_GRANU1 BIT_7
 #define UART_SCR_TX_TRIG_GRANU1 BIT_6
+#define UART_SCR_TXEMPTYCTLIT   BIT_3
+#define UART_SCR_DMAMODE2_MASK  (BIT_2 | BIT_1)
+#define UART_SCR_DMAMODE2_SHFT  1
+#define UART_SCR_DMAMODECTL     BIT_0
+
+#define UART_SSR_RX_CTS_DSR_WAKE_UP_STS BIT_1
+#define UART_SSR_TXFIFOFULL             BIT_0
 
 #define UART_DLL_CLOCK_LSB(val) ((val) & 0xff)
 #define UART_DLH_CLOCK_MSB(val) (((val) >> 8) & 0x3f)
@@ -870,6 +914,66 @@ enum {
 };
 #define UART_MDR1_MODESELECT(val) ((val) & 0x7)
 
+/*********************** EDMA3 MODULE ****************************************/
+#define EDMA_TPCC_BASE_ADDR 0x49000000
+
+#define EDMA_PID                HWREG32(EDMA_TPCC_BASE_ADDR + 0x000)
+#define EDMA_CCCFG              HWREG32(EDMA_TPCC_BASE_ADDR + 0x004)
+#define EDMA_DCHMAP(n)          HWREG32(EDMA_TPCC_BASE_ADDR + 0x100 + 4 * (n))
+#define EDMA_DMAQNUM(n)         HWREG32(EDMA_TPCC_BASE_ADDR + 0x240 + 4 * (n))
+#define EDMA_QUEPRI             HWREG32(EDMA_TPCC_BASE_ADDR + 0x284)
+#define EDMA_EMR(n)             HWREG32(EDMA_TPCC_BASE_ADDR + 0x300 + 4 * (n))
+#define EDMA_EMCR(n)            HWREG32(EDMA_TPCC_BASE_ADDR + 0x308 + 4 * (n))
+#define EDMA_CCERR              HWREG32(EDMA_TPCC_BASE_ADDR + 0x318)
+#define EDMA_CCERRCLR           HWREG32(EDMA_TPCC_BASE_ADDR + 0x31C)
+#define EDMA_DRAE(r, n)         HWREG32(EDMA_TPCC_BASE_ADDR + 0x340 + 8 * (r) \
+                                                            + 4 * (n))
+
+/* Channel registers as seen through shadow region 0. Only the channels
+ * enabled in DRAE(0, n) show up here. n selects channels 0-31 or 32-63 */
+#define EDMA_S0_BASE_ADDR       (EDMA_TPCC_BASE_ADDR + 0x2000)
+#define EDMA_S0_ER(n)           HWREG32(EDMA_S0_BASE_ADDR + 0x00 + 4 * (n))
+#define EDMA_S0_ECR(n)          HWREG32(EDMA_S0_BASE_ADDR + 0x08 + 4 * (n))
+#define EDMA_S0_ESR(n)          HWREG32(EDMA_S0_BASE_ADDR + 0x10 + 4 * (n))
+#define EDMA_S0_CER(n)          HWREG32(EDMA_S0_BASE_ADDR + 0x18 + 4 * (n))
+#define EDMA_S0_EER(n)          HWREG32(EDMA_S0_BASE_ADDR + 0x20 + 4 * (n))
+#define EDMA_S0_EECR(n)         HWREG32(EDMA_S0_BASE_ADDR + 0x28 + 4 * (n))
+#define EDMA_S0_EESR(n)         HWREG32(EDMA_S0_BASE_ADDR + 0x30 + 4 * (n))
+#define EDMA_S0_SER(n)          HWREG32(EDMA_S0_BASE_ADDR + 0x38 + 4 * (n))
+#define EDMA_S0_SECR(n)         HWREG32(EDMA_S0_BASE_ADDR + 0x40 + 4 * (n))
+#define EDMA_S0_IER(n)          HWREG32(EDMA_S0_BASE_ADDR + 0x50 + 4 * (n))
+#define EDMA_S0_IECR(n)         HWREG32(EDMA_S0_BASE_ADDR + 0x58 + 4 * (n))
+#define EDMA_S0_IESR(n)         HWREG32(EDMA_S0_BASE_ADDR + 0x60 + 4 * (n))
+#define EDMA_S0_IPR(n)          HWREG32(EDMA_S0_BASE_ADDR + 0x68 + 4 * (n))
+#define EDMA_S0_ICR(n)          HWREG32(EDMA_S0_BASE_ADDR + 0x70 + 4 * (n))
+#define EDMA_S0_IEVAL           HWREG32(EDMA_S0_BASE_ADDR + 0x78)
+
+/* PaRAM sets, 8 words each */
+#define EDMA_PARAM(n, word)     HWREG32(EDMA_TPCC_BASE_ADDR + 0x4000 \
+                                        + 0x20 * (n) + 4 * (word))
+#define EDMA_PARAM_DST(n)       EDMA_PARAM(n, 3)
+
+#define EDMA_OPT_ITCCHEN        BIT_23
+#define EDMA_OPT_TCCHEN         BIT_22
+#define EDMA_OPT_ITCINTEN       BIT_21
+#define EDMA_OPT_TCINTEN        BIT_20
+#define EDMA_OPT_TCC(val)       (((val) & 0x3F) << 12)
+#define EDMA_OPT_TCCMODE        BIT_11
+#define EDMA_OPT_STATIC         BIT_3
+#define EDMA_OPT_SYNCDIM        BIT_2   /* AB-sync, A-sync when clear */
+#define EDMA_OPT_DAM            BIT_1   /* Constant addressing */
+#define EDMA_OPT_SAM            BIT_0
+
+#define EDMA_DCHMAP_PAENTRY(val) (((val) & 0x1FF) << 5)
+
+/* Direct mapped events, s11.3.20 of am335x TRM */
+#define EDMA_EVT_UART0_TX 26
+#define EDMA_EVT_UART0_RX 27
+#define EDMA_EVT_UART1_TX 28
+#define EDMA_EVT_UART1_RX 29
+#define EDMA_EVT_UART2_TX 30
+#define EDMA_EVT_UART2_RX 31
+
 /*********************** MMC/SD MODULE ****************************************/
 #define MMC0_BASE_ADDR 0x48060000
 
@@ -1140,4 +1244,43 @@ enum {
 
 #define SYSTICK_TOCR_OVF_COUNTER_VALUE(val) (((val) & 0xfff))
 
+/*************************** TIMER2 CLOCK *************************************/
+#define CLOCK_BASE_ADDR 0x48040000
+
+#define CLOCK_TIDR          HWREG32(CLOCK_BASE_ADDR + 0x00)
+#define CLOCK_TIOCP_CFG     HWREG32(CLOCK_BASE_ADDR + 0x10)
+#define CLOCK_IRQ_EOI       HWREG32(CLOCK_BASE_ADDR + 0x20)
+#define CLOCK_IRQSTATUS_RAW HWREG32(CLOCK_BASE_ADDR + 0x24)
+#define CLOCK_IRQSTATUS     HWREG32(CLOCK_BASE_ADDR + 0x28)
+#define CLOCK_IRQENABLE_SET HWREG32(CLOCK_BASE_ADDR + 0x2C)
+#define CLOCK_IRQENABLE_CLR HWREG32(CLOCK_BASE_ADDR + 0x30)
+#define CLOCK_IRQWAKEEN     HWREG32(CLOCK_BASE_ADDR + 0x34)
+#define CLOCK_TCLR          HWREG32(CLOCK_BASE_ADDR + 0x38)
+#define CLOCK_TCRR          HWREG32(CLOCK_BASE_ADDR + 0x3C)
+#define CLOCK_TLDR          HWREG32(CLOCK_BASE_ADDR + 0x40)
+#define CLOCK_TTGR          HWREG32(CLOCK_BASE_ADDR + 0x44)
+#define CLOCK_TWPS          HWREG32(CLOCK_BASE_ADDR + 0x48)
+#define CLOCK_TMAR          HWREG32(CLOCK_BASE_ADDR + 0x4C)
+#define CLOCK_TCAR1         HWREG32(CLOCK_BASE_ADDR + 0x50)
+#define CLOCK_TSICR         HWREG32(CLOCK_BASE_ADDR + 0x54)
+#define CLOCK_TCAR2         HWREG32(CLOCK_BASE_ADDR + 0x58)
+
+#define CLOCK_TIOCP_IDLEMODE(val)   (((val) & 0x3) << 2)
+#define CLOCK_TIOCP_EMUFREE         BIT_1
+#define CLOCK_TIOCP_SOFTRESET       BIT_0
+
+#define CLOCK_TCLR_AR               BIT_1
+#define CLOCK_TCLR_ST               BIT_0
+
+#define CLOCK_TSICR_POSTED          BIT_2
+
+#define CLOCK_TWPS_W_PEND_TTGR      BIT_3
+#define CLOCK_TWPS_W_PEND_TLDR      BIT_2
+#define CLOCK_TWPS_W_PEND_TCRR      BIT_1
+#define CLOCK_TWPS_W_PEND_TCLR      BIT_0
+
+#define CLOCK_CLKSEL_TCLKIN         0x0
+#define CLOCK_CLKSEL_CLK_M_OSC      0x1
+#define CLOCK_CLKSEL_CLK_32KHZ      0x2
+
 #endif
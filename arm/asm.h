@@ -15,16 +15,36 @@
 
 #ifndef __ARM_ASM_H__
 #define __ARM_ASM_H__
+#include <stdint.h>
 
 #define _dsb()                                                              \
 {                                                                           \
     asm volatile("dsb");                                                    \
 }
+#define _dmb()                                                              \
+{                                                                           \
+    asm volatile("dmb" : : : "memory");                                     \
+}
 #define _isb()                                                              \
 {                                                                           \
     asm volatile("isb");                                                    \
 }
 
+/* Single cache line maintenance by address, to the point of coherency */
+#define _dcache_clean_mva(addr)                                             \
+{                                                                           \
+    asm volatile ("mcr p15, #0, %[in], c7, c10, #1" : : [in] "r" (addr));   \
+}
+#define _dcache_invalidate_mva(addr)                                        \
+{                                                                           \
+    asm volatile ("mcr p15, #0, %[in], c7, c6, #1" : : [in] "r" (addr));    \
+}
+
+#if HOST_BUILD
+/* Host builds (sim/) compile the drivers natively, only the swaps are used */
+#define _swap16(x) { (x) = __builtin_bswap16(x); }
+#define _swap32(x) { (x) = __builtin_bswap32(x); }
+#else
 #define _swap16(x)                                                          \
 {                                                                           \
     asm volatile ("rev16 %[out], %[in]" : [out] "=r" (x) : [in]   "r" (x)); \
@@ -33,15 +53,27 @@
 {                                                                           \
     asm volatile ("rev %[out], %[in]" : [out] "=r" (x) : [in]   "r" (x));   \
 }
+#endif
 
 #define _irq_enable()                                                       \
 {                                                                           \
-    asm volatile ("cpsie i")                                                \
+    asm volatile ("cpsie i");                                               \
 }
 #define _irq_disable()                                                      \
 {                                                                           \
     asm volatile ("cpsid i");                                               \
 }
+/* Masks IRQs, keeping the previous CPSR in flags for _irq_restore() */
+#define _irq_save(flags)                                                    \
+{                                                                           \
+    asm volatile ("mrs %[out], cpsr\n\t"                                   \
+                  "cpsid i" : [out] "=r" (flags) : : "memory");             \
+}
+#define _irq_restore(flags)                                                 \
+{                                                                           \
+    asm volatile ("msr cpsr_c, %[in]" : : [in] "r" (flags) : "memory");     \
+}
+
 #define _irq_set_addr(addr)                                                 \
 {                                                                           \
     asm volatile ("mcr p15, #0, %[in], c12, c0, #0" : : [in] "r" (addr));   \
@@ -52,6 +84,9 @@
 extern void _dcache_enable(void);
 extern void _dcache_disable(void);
 extern void _dcache_flush(void);
+extern void _dcache_clean_range(const void *addr, uint32_t len);
+extern void _dcache_invalidate_range(const void *addr, uint32_t len);
+extern void _dcache_clean_invalidate_range(const void *addr, uint32_t len);
 
 extern void _icache_enable(void);
 extern void _icache_disable(void);
@@ -60,4 +95,14 @@ extern void _icache_flush(void);
 extern void _branch_predict_enable(void);
 extern void _branch_predict_disable(void);
 extern void _branch_predict_invalidate(void);
+
+extern void _vfp_init(void);
+extern void _vfp_enable(uint32_t on);
+extern void _vfp_save(void *ctx);
+extern void _vfp_restore(const void *ctx);
+extern uint32_t _vfp_check(uint32_t seed, void (*yield)(void));
+
+/* arm/string.S also replaces memcpy/memset/memcmp. These need the VFP on */
+extern void *_memcpy_neon(void *dst, const void *src, uint32_t len);
+extern void *_memset_neon(void *dst, int c, uint32_t len);
 #endif
@@ -13,36 +13,237 @@
  *
  *****************************************************************************/
 
+#include <stddef.h>
 #include <stdint.h>
+#include "asm.h"
 #include "mmu.h"
 
 #define PAGE_TYPE_FAULT   ((0x0 << 18) | (0x0))
 #define PAGE_TYPE_L2      ((0x0 << 18) | (0x1))
 #define PAGE_TYPE_L1_1MB  ((0x0 << 18) | (0x2))
 #define PAGE_TYPE_L1_16MB ((0x1 << 18) | (0x2))
+#define PAGE_TYPE_MASK    ((0x1 << 18) | (0x3))
+
+#define PAGE_TYPE_L2_64KB (0x1)
+#define PAGE_TYPE_L2_4KB  (0x2)
+
+#define SIZE_16MB         0x01000000
+#define SIZE_1MB          0x00100000
+#define SIZE_64KB         0x00010000
+#define SIZE_4KB          0x00001000
+
+#define L2_ENTRIES        256
 
 /*
  * ARM Doc DEN0013C, s10.7.3
  * Domains are deprecated as of ARMv7. Still necessary to assign a
  * dummy domain and enable client permissions though.
+ * Supersections have no domain field, those bits extend the address.
  */
 #define DOMAIN_DEPRECATED  (0x1 << 5)
 
 static uint32_t __attribute__ ((aligned(16*1024))) ttb0[4096];
+static uint32_t __attribute__ ((aligned(1024))) l2Tables[MMU_L2_TABLES][L2_ENTRIES];
+static uint32_t l2Used;    /* Bit per table, MMU_L2_TABLES <= 32 */
 
-/* TODO: Support 16MB regions to reduce TLB entries */
-void _mmu_add_region(mmuRegion_t *region)
+/*
+ * mmuClean()
+ *
+ * Table walks don't look in the data cache, push updated entries out
+ */
+static void mmuClean(const uint32_t *entry, uint32_t count)
 {
+    _dcache_clean_range(entry, count * sizeof(uint32_t));
+}
+
+/*
+ * l2Attributes()
+ *
+ * Section attributes and permissions moved to where an L2 page keeps them,
+ * DDI0406C sB3.5.1. C/B stay put, AP moves to 5:4, APX to 9, S to 10 and nG
+ * to 11. TEX and XN go to 8:6 and 0 for small pages, 14:12 and 15 for large
+ * ones.
+ */
+static uint32_t l2Attributes(uint32_t l1, uint32_t pageSize)
+{
+    uint32_t cb  = l1 & (0x3 << 2);
+    uint32_t ap  = ((l1 >> 10) & 0x3) << 4;
+    uint32_t apx = ((l1 >> 15) & 0x1) << 9;
+    uint32_t sng = ((l1 >> 16) & 0x3) << 10;
+    uint32_t tex = (l1 >> 12) & 0x7;
+    uint32_t xn  = (l1 >>  4) & 0x1;
+
+    if (pageSize == MMU_PAGE_64KB)
+        return cb | ap | apx | sng | (tex << 12) | (xn << 15) |
+               PAGE_TYPE_L2_64KB;
+    return cb | ap | apx | sng | (tex << 6) | xn | PAGE_TYPE_L2_4KB;
+}
+
+/*
+ * l2Release()
+ *
+ * Hands the L2 table behind MB idx, if any, back to the pool. The caller
+ * overwrites the entry and flushes the TLB before the table is reused.
+ */
+static void l2Release(uint32_t idx)
+{
+    uint32_t entry = ttb0[idx];
+    uint32_t table;
+
+    if ((entry & PAGE_TYPE_MASK) != PAGE_TYPE_L2)
+        return;
+
+    table = ((entry & 0xfffffc00) - (uint32_t)l2Tables) / sizeof(l2Tables[0]);
+    l2Used &= ~(1 << table);
+}
+
+/*
+ * l1Split()
+ *
+ * Turns the supersection covering MB idx, if any, back into 16 sections so
+ * part of it can be remapped
+ */
+static void l1Split(uint32_t idx)
+{
+    uint32_t first = idx & ~0xf;
+    uint32_t entry = ttb0[first];
+    int i;
+
+    if ((entry & PAGE_TYPE_MASK) != PAGE_TYPE_L1_16MB)
+        return;
+
+    for (i = 0; i < 16; i++)
+        ttb0[first + i] = ((entry & ~PAGE_TYPE_MASK) + (i << 20))
+                        | DOMAIN_DEPRECATED
+                        | PAGE_TYPE_L1_1MB;
+    mmuClean(&ttb0[first], 16);
+}
+
+/*
+ * l2Table()
+ *
+ * RETURNS: The L2 table for MB idx, taken from the pool and filled in with
+ *          whatever the MB was mapped as the first time. NULL if the pool
+ *          has run out.
+ */
+static uint32_t *l2Table(uint32_t idx)
+{
+    uint32_t entry;
+    uint32_t *table;
+    int i;
+
+    l1Split(idx);
+    entry = ttb0[idx];
+
+    if ((entry & PAGE_TYPE_MASK) == PAGE_TYPE_L2)
+        return (uint32_t *)(entry & 0xfffffc00);
+
+    for (i = 0; i < MMU_L2_TABLES && (l2Used & (1 << i)); i++)
+        ;
+    if (i == MMU_L2_TABLES)
+        return NULL;
+    l2Used |= 1 << i;
+
+    table = l2Tables[i];
+    for (i = 0; i < L2_ENTRIES; i++) {
+        if ((entry & PAGE_TYPE_MASK) == PAGE_TYPE_L1_1MB)
+            table[i] = ((entry & 0xfff00000) + (i << 12))
+                     | l2Attributes(entry, MMU_PAGE_4KB);
+        else
+            table[i] = PAGE_TYPE_FAULT;
+    }
+    mmuClean(table, L2_ENTRIES);
+
+    ttb0[idx] = (uint32_t)table | DOMAIN_DEPRECATED | PAGE_TYPE_L2;
+    mmuClean(&ttb0[idx], 1);
+    return table;
+}
+
+static void mmuMapSections(mmuRegion_t *region)
+{
+    uint32_t phys  = region->physAddr & 0xfff00000;
     uint32_t idx   = region->virtAddr >> 20; /* 1MB Pages */
-    uint32_t entry = (region->physAddr & 0xfff00000)
-                   |  region->attributes
-                   |  region->permissions
-                   |  DOMAIN_DEPRECATED
-                   |  PAGE_TYPE_L1_1MB;
+    uint32_t first = idx;
+    uint32_t pages = region->pages;
+    uint32_t bits  = region->attributes | region->permissions;
+    int i;
+
+    while (pages) {
+        if (pages >= 16 && ((phys | (idx << 20)) & (SIZE_16MB - 1)) == 0) {
+            for (i = 0; i < 16; i++) {
+                l2Release(idx);
+                ttb0[idx++] = phys | bits | PAGE_TYPE_L1_16MB;
+            }
+            phys  += SIZE_16MB;
+            pages -= 16;
+        }
+        else {
+            l1Split(idx);
+            l2Release(idx);
+            ttb0[idx++] = phys | bits | DOMAIN_DEPRECATED | PAGE_TYPE_L1_1MB;
+            phys  += SIZE_1MB;
+            pages -= 1;
+        }
+    }
+    mmuClean(&ttb0[first], idx - first);
+}
+
+static int mmuMapPages(mmuRegion_t *region)
+{
+    uint32_t size   = (region->pageSize == MMU_PAGE_64KB) ? SIZE_64KB : SIZE_4KB;
+    uint32_t slots  = size / SIZE_4KB;  /* Large pages repeat 16 times */
+    uint32_t phys   = region->physAddr;
+    uint32_t virt   = region->virtAddr;
+    uint32_t bits   = l2Attributes(region->attributes | region->permissions,
+                                   region->pageSize);
+    uint32_t *table;
+    uint32_t slot;
     int i;
+    int j;
+
+    if ((phys | virt) & (size - 1))
+        return -1;
+
+    for (i = 0; i < region->pages; i++) {
+        table = l2Table(virt >> 20);
+        if (table == NULL)
+            return -1;
+
+        slot = (virt >> 12) & (L2_ENTRIES - 1);
+        for (j = 0; j < slots; j++)
+            table[slot + j] = phys | bits;
+        mmuClean(&table[slot], slots);
+
+        phys += size;
+        virt += size;
+    }
+    return 0;
+}
+
+/*
+ * _mmu_add_region()
+ *
+ * Maps the region over whatever was there before. Safe to call with the MMU
+ * on, though the region being remapped shouldn't be in use.
+ *
+ * RETURNS: 0, or -1 if addresses aren't aligned to pageSize or the L2 pool
+ *          ran out (the pages before were mapped)
+ */
+int _mmu_add_region(mmuRegion_t *region)
+{
+    int status = 0;
+
+    if (region->pageSize == MMU_PAGE_1MB)
+        mmuMapSections(region);
+    else
+        status = mmuMapPages(region);
+
+    /* Flush both instruction and data TLB */
+    asm volatile ("mcr p15,0,r0,c8,c7,0");
+    _dsb();
+    _isb();
 
-    for (i = 0; i < region->pages; i++)
-        ttb0[idx++] = entry + (i << 20); /* 1MB Pages */
+    return status;
 }
 
 void _mmu_enable(void)
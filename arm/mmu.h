@@ -24,6 +24,7 @@
 #define MMU_ATTR_OUTER_WB_WA    ((0x5 << 12) | (0x0 << 2)) /* TEX:101 C:0 B:0 */
 #define MMU_ATTR_OUTER_WB_NOWA  ((0x7 << 12) | (0x0 << 2)) /* TEX:111 C:0 B:0 */
 #define MMU_ATTR_OUTER_WT_NOWA  ((0x6 << 12) | (0x0 << 2)) /* TEX:110 C:0 B:0 */
+#define MMU_ATTR_NONCACHEABLE   ((0x1 << 12) | (0x0 << 2)) /* TEX:001 C:0 B:0 */
 #define MMU_ATTR_EXECUTE_NEVER  ((0x1 <<  4))              /* XN:1            */
 
 #define MMU_PERM_NO_ACCESS      ((0x0 << 15) | (0x0 << 10)) /* APX:0 AP:00 */
@@ -33,15 +34,29 @@
 #define MMU_PERM_SYS_RW_USR_RO  ((0x0 << 15) | (0x2 << 10)) /* APX:0 AP:10 */
 #define MMU_PERM_SYS_RW_USR_RW  ((0x0 << 15) | (0x3 << 10)) /* APX:0 AP:11 */
 
+/* 1MB regions are mapped with 16MB supersections wherever the addresses and
+ * the remaining length line up, sections otherwise. 64KB and 4KB pages go in
+ * L2 tables, one per MB touched, from a pool of MMU_L2_TABLES. Mapping pages
+ * inside an existing section keeps the rest of that MB as it was. Mapping a
+ * section over an L2 table hands the table back to the pool. */
+enum {
+    MMU_PAGE_1MB = 0,
+    MMU_PAGE_64KB,
+    MMU_PAGE_4KB,
+};
+
+#define MMU_L2_TABLES   8   /* 1KB each */
+
 typedef struct {
     uint32_t physAddr;
     uint32_t virtAddr;
-    uint32_t pages; /* 1MB per page */
+    uint32_t pages;     /* Of pageSize each */
+    uint32_t pageSize;  /* MMU_PAGE_xxx, 1MB if left out */
     uint32_t attributes;
     uint32_t permissions;
 } mmuRegion_t;
 
 extern void _mmu_enable(void);
 extern void _mmu_disable(void);
-extern void _mmu_add_region(mmuRegion_t *region);
+extern int  _mmu_add_region(mmuRegion_t *region);
 #endif
@@ -4,6 +4,16 @@
  *
  * Functions to utilize the ARMv7 Perfomance monitor module
  *
+ * The hardware counters are 32 bits, which the cycle counter wraps in a
+ * few seconds. Each counter gets a software upper half that
+ * _perfmon_overflow_isr() bumps on the overflow interrupt. Reads fold in
+ * an overflow that is flagged but not yet serviced, so values are exact as
+ * long as the ISR runs at least once per wrap.
+ *
+ * A counter can instead be put in sampling mode with _perfmon_sample(): it
+ * is preloaded to overflow every period events and the ISR calls a hook
+ * with the interrupted context each time, for statistical profiling.
+ *
  * Copyright (C) 2013 Paul Quevedo
  *
  * This program is free software.  It comes without any warranty, to the extent
@@ -14,15 +24,78 @@
  *****************************************************************************/
 
 #include <stdint.h>
+#include "asm.h"
 #include "perfmon.h"
 
+#define CYCLE_COUNTER_BIT (1 << 31)
+
 static uint32_t numCnt;
+static volatile uint32_t cycleHigh;
+static volatile uint32_t eventHigh[PERF_MON_MAX_COUNTERS];
+static volatile uint32_t samplePeriod[PERF_MON_MAX_COUNTERS];
+static perfmonSampleHook_t sampleHook[PERF_MON_MAX_COUNTERS];
+
+static inline uint32_t readOverflow(void)
+{
+    uint32_t reg;
+    asm volatile("mrc p15, 0, %[out], c9, c12, 3" : [out] "=r"(reg) : );
+    return reg;
+}
+
+static inline void clearOverflow(uint32_t mask)
+{
+    asm volatile("mcr p15, 0, %[in], c9, c12, 3" : : [in] "r"(mask));
+}
+
+static inline void writeCounter(uint32_t counterSel, uint32_t value)
+{
+    asm volatile("mcr p15, 0, %[in], c9, c12, 5" : : [in] "r"(counterSel));
+    _isb();
+    asm volatile("mcr p15, 0, %[in], c9, c13, 2" : : [in] "r"(value));
+}
+
+static inline uint32_t readCounter(uint32_t counterSel)
+{
+    uint32_t reg;
+
+    if (counterSel == PERF_MON_CYCLE_COUNTER)
+        return _perfmon_ccnt();
+
+    /* Select Counter */
+    asm volatile("mcr p15, 0, %[in], c9, c12, 5" : : [in] "r"(counterSel));
+    _isb();
+    /* Read event counter */
+    asm volatile("mrc p15, 0, %[out],c9, c13, 2" : [out] "=r"(reg) : );
+    return reg;
+}
+
+/* Must be called with IRQs masked */
+static uint64_t read64(uint32_t counterSel)
+{
+    uint32_t bit  = (counterSel == PERF_MON_CYCLE_COUNTER) ?
+                     CYCLE_COUNTER_BIT : (1 << counterSel);
+    uint32_t high = (counterSel == PERF_MON_CYCLE_COUNTER) ?
+                     cycleHigh : eventHigh[counterSel];
+    uint32_t low  = readCounter(counterSel);
+
+    /* Wrapped since the ISR last ran. Re-read, low may predate the wrap */
+    if (readOverflow() & bit) {
+        low = readCounter(counterSel);
+        high++;
+    }
+
+    return ((uint64_t)high << 32) | low;
+}
 
 int _perfmon_add(uint32_t counterSel, uint32_t event)
 {
+    uint32_t mask;
+
     if (numCnt == 0) {
         asm volatile("mrc p15,0,%[out],c9,c12,0" : [out] "=r"(numCnt) : );
         numCnt = (numCnt >> 11) & 0x1f;
+        if (numCnt > PERF_MON_MAX_COUNTERS)
+            numCnt = PERF_MON_MAX_COUNTERS;
     }
 
     if (counterSel == PERF_MON_CYCLE_COUNTER)
@@ -35,70 +108,169 @@ int _perfmon_add(uint32_t counterSel, uint32_t event)
     asm volatile("mcr p15, 0, %[in], c9, c12, 5" : : [in] "r"(counterSel));
     asm volatile("mcr p15, 0, %[in], c9, c13, 1" : : [in] "r"(event));
 
-    /* Enable counter */
-    counterSel = 1 << counterSel;
-    asm volatile("mcr p15, 0, %[in], c9, c12, 1" : : [in] "r"(counterSel));
+    /* Enable counter and its overflow interrupt */
+    mask = 1 << counterSel;
+    asm volatile("mcr p15, 0, %[in], c9, c12, 1" : : [in] "r"(mask));
+    asm volatile("mcr p15, 0, %[in], c9, c14, 1" : : [in] "r"(mask));
 
     return 0;
 }
 
+/*
+ * _perfmon_get()
+ *
+ * Low 32 bits of the extended count. Differences of two reads are right
+ * across a wrap, use _perfmon_get64() for absolute values.
+ */
 uint32_t _perfmon_get(uint32_t counterSel)
 {
-    volatile uint32_t reg;
+    return (uint32_t)_perfmon_get64(counterSel);
+}
 
-    if (counterSel == PERF_MON_CYCLE_COUNTER) {
-        /* Check for overflow */
-        asm volatile("mrc p15, 0, %[out],c9, c12, 3" : [out] "=r"(reg) : );
-        if (reg & (1 << 31))
-            return 0xffffffff;
-
-        /* Read Cycle Count Register */
-        asm volatile("mrc p15, 0, %[out],c9, c13, 0" : [out] "=r"(reg) : );
-        return reg;
-    }
+uint64_t _perfmon_get64(uint32_t counterSel)
+{
+    uint32_t flags;
+    uint64_t value;
 
-    if (counterSel >= numCnt)
+    if (counterSel != PERF_MON_CYCLE_COUNTER && counterSel >= numCnt)
         return 0;
 
-    /* Check for counter overflow */
-    asm volatile("mrc p15, 0, %[out],c9, c12, 3" : [out] "=r"(reg) : );
-    if (reg & (1 << counterSel))
-        return 0xffffffff;
+    _irq_save(flags);
+    value = read64(counterSel);
+    _irq_restore(flags);
 
-    /* Select Counter */
-    asm volatile("mcr p15, 0, %[in], c9, c12, 5" : : [in] "r"(counterSel));
-    /* Read event counter */
-    asm volatile("mrc p15, 0, %[out],c9, c13, 2" : [out] "=r"(reg) : );
+    return value;
+}
 
-    return reg;
+/*
+ * _perfmon_snapshot()
+ *
+ * Reads every counter in one go with IRQs masked, so the values in snap
+ * are consistent with each other. Unused counters read as 0.
+ */
+void _perfmon_snapshot(perfmonSnapshot_t *snap)
+{
+    uint32_t flags;
+    int i;
+
+    _irq_save(flags);
+    snap->cycles = read64(PERF_MON_CYCLE_COUNTER);
+    for (i = 0; i < PERF_MON_MAX_COUNTERS; i++)
+        snap->events[i] = (i < numCnt) ? read64(i) : 0;
+    _irq_restore(flags);
+}
+
+void _perfmon_delta(const perfmonSnapshot_t *start,
+                    const perfmonSnapshot_t *end,
+                    perfmonSnapshot_t *delta)
+{
+    int i;
+
+    delta->cycles = end->cycles - start->cycles;
+    for (i = 0; i < PERF_MON_MAX_COUNTERS; i++)
+        delta->events[i] = end->events[i] - start->events[i];
+}
+
+/*
+ * _perfmon_sample()
+ *
+ * Counts event on counterSel and calls hook from the overflow ISR every
+ * period events. The counter no longer reads as a count. A period of 0
+ * stops sampling. The cycle counter is never used, it keeps time for
+ * everyone else.
+ */
+int _perfmon_sample(uint32_t counterSel, uint32_t event,
+                    uint32_t period, perfmonSampleHook_t hook)
+{
+    uint32_t flags;
+
+    if (counterSel >= numCnt || (period && !hook))
+        return -1;
+
+    _irq_save(flags);
+    samplePeriod[counterSel] = period;
+    sampleHook[counterSel]   = period ? hook : 0;
+    _perfmon_add(counterSel, event);
+    writeCounter(counterSel, -period);
+    clearOverflow(1 << counterSel);
+    eventHigh[counterSel] = 0;
+    _irq_restore(flags);
+
+    return 0;
+}
+
+/*
+ * _perfmon_overflow_isr()
+ *
+ * PMU overflow interrupt, carries each wrapped counter into its upper half
+ * or, for sampling counters, rearms them and takes the sample
+ */
+void _perfmon_overflow_isr(uint32_t *frame, uint32_t lr)
+{
+    uint32_t overflow = readOverflow();
+    int i;
+
+    clearOverflow(overflow);
+
+    if (overflow & CYCLE_COUNTER_BIT)
+        cycleHigh++;
+    for (i = 0; i < numCnt; i++) {
+        if (!(overflow & (1 << i)))
+            continue;
+
+        if (samplePeriod[i]) {
+            /* Keep the events counted since the wrap */
+            writeCounter(i, readCounter(i) - samplePeriod[i]);
+            sampleHook[i](frame, lr);
+        } else {
+            eventHigh[i]++;
+        }
+    }
 }
 
 int _perfmon_reset(uint32_t counterSel)
 {
     volatile uint32_t reg = 0;
+    uint32_t flags;
 
+    _irq_save(flags);
     if (counterSel == PERF_MON_CYCLE_COUNTER) {
         asm volatile("mcr p15, 0, %[in],c9, c13, 0" : : [in] "r"(reg));
+        clearOverflow(CYCLE_COUNTER_BIT);
+        cycleHigh = 0;
     }
-    else if (counterSel <= numCnt) {
+    else if (counterSel < numCnt) {
         asm volatile("mcr p15, 0, %[in],c9, c12, 5" : : [in] "r"(counterSel));
         asm volatile("mcr p15, 0, %[in],c9, c13, 2" : : [in] "r"(reg));
+        clearOverflow(1 << counterSel);
+        eventHigh[counterSel] = 0;
     } else {
+        _irq_restore(flags);
         return -1;
     }
+    _irq_restore(flags);
+
     return 0;
 }
 
 int _perfmon_enable(void)
 {
     volatile uint32_t reg;
+    int i;
 
     if (numCnt == 0)
         return -1;
 
-    /* Enable the cpu cycle counter */
-    reg = 0x80000000;
+    /* Enable the cpu cycle counter and its overflow interrupt */
+    reg = CYCLE_COUNTER_BIT;
     asm volatile("mcr p15, 0, %[in], c9, c12, 1" : : [in] "r"(reg));
+    asm volatile("mcr p15, 0, %[in], c9, c14, 1" : : [in] "r"(reg));
+
+    /* Fresh start for the upper halves too */
+    clearOverflow(0xffffffff);
+    cycleHigh = 0;
+    for (i = 0; i < PERF_MON_MAX_COUNTERS; i++)
+        eventHigh[i] = 0;
 
     asm volatile("mrc p15, 0, %[out], c9, c12, 0" : [out] "=r"(reg) : );
     reg |= 0x7; /* Reset Cycle Counter,
@@ -10,14 +10,91 @@ enum {
     PERF_MON_L1D_CACHE_REFILL,
     PERF_MON_L1D_CACHE,
     PERF_MON_L1D_TLB_REFILL,
+    PERF_MON_LD_RETIRED,
+    PERF_MON_ST_RETIRED,
+    PERF_MON_INST_RETIRED,
+    PERF_MON_EXC_TAKEN,
+    PERF_MON_EXC_RETURN,
+    PERF_MON_CID_WRITE_RETIRED,
+    PERF_MON_PC_WRITE_RETIRED,
+    PERF_MON_BR_IMMED_RETIRED,
+    PERF_MON_BR_RETURN_RETIRED,
+    PERF_MON_UNALIGNED_LDST_RETIRED,
+    PERF_MON_BR_MIS_PRED,
+    PERF_MON_CPU_CYCLES,
+    PERF_MON_BR_PRED,
+
+    /* Cortex-A8, table 3-140 of DDI0344K */
+    PERF_MON_A8_WRITE_BUFFER_FULL = 0x40,
+    PERF_MON_A8_L2_STORE_MERGED,
+    PERF_MON_A8_L2_STORE_BUFF,
+    PERF_MON_A8_L2_ACCESS,
+    PERF_MON_A8_L2_CACHE_MISS,
+    PERF_MON_A8_AXI_READ_CYCLES,
+    PERF_MON_A8_AXI_WRITE_CYCLES,
+    PERF_MON_A8_MEMORY_REPLAY,
+    PERF_MON_A8_UNALIGNED_ACCESS_REPLAY,
+    PERF_MON_A8_L1_DATA_MISS,           /* Misses due to hashing */
+    PERF_MON_A8_L1_INST_MISS,           /* Misses due to hashing */
+    PERF_MON_A8_L1_DATA_COLORING,
+    PERF_MON_A8_L1_NEON_DATA,
+    PERF_MON_A8_L1_NEON_CACHEABLE_DATA,
+    PERF_MON_A8_L2_NEON,
+    PERF_MON_A8_L2_NEON_HIT,
+    PERF_MON_A8_L1_INST,
+    PERF_MON_A8_RETURN_STACK_MISPREDICT,
+    PERF_MON_A8_BRANCH_DIR_MISPREDICT,
+    PERF_MON_A8_PRED_BRANCH_PRED_TAKEN,
+    PERF_MON_A8_PRED_BRANCH_TAKEN,
+    PERF_MON_A8_OPS_ISSUED,
+    PERF_MON_A8_CYCLES_INST_STALL,
+    PERF_MON_A8_INST_ISSUED_CYCLE,
+    PERF_MON_A8_NEON_DATA_STALL,
+    PERF_MON_A8_NEON_CYCLES,
+    PERF_MON_A8_NEON_AND_INT_CYCLES,
+    PERF_MON_A8_PMUEXTIN0 = 0x70,
+    PERF_MON_A8_PMUEXTIN1,
+    PERF_MON_A8_PMUEXTIN_BOTH,
 
     PERF_MON_CYCLE_COUNTER = 0xffff,
 };
 
+/* Event counters implemented by the Cortex-A8 */
+#define PERF_MON_MAX_COUNTERS 4
+
+/* Left free for _perfmon_sample() users such as the profiler */
+#define PERF_MON_SAMPLE_COUNTER (PERF_MON_MAX_COUNTERS - 1)
+
+/* Called from the overflow ISR with the interrupted context, see start.S */
+typedef void (*perfmonSampleHook_t)(uint32_t *frame, uint32_t lr);
+
+/* All counters read together, extended to 64 bits */
+typedef struct {
+    uint64_t cycles;
+    uint64_t events[PERF_MON_MAX_COUNTERS];
+} perfmonSnapshot_t;
+
 extern int _perfmon_add(uint32_t counterSel, uint32_t event);
 extern int _perfmon_reset(uint32_t counterSel);
 extern int _perfmon_enable(void);
 extern int _perfmon_disable(void);
 
 extern uint32_t _perfmon_get(uint32_t counterSel);
+extern uint64_t _perfmon_get64(uint32_t counterSel);
+extern void     _perfmon_snapshot(perfmonSnapshot_t *snap);
+extern void     _perfmon_delta(const perfmonSnapshot_t *start,
+                               const perfmonSnapshot_t *end,
+                               perfmonSnapshot_t *delta);
+extern int      _perfmon_sample(uint32_t counterSel, uint32_t event,
+                                uint32_t period, perfmonSampleHook_t hook);
+extern void     _perfmon_overflow_isr(uint32_t *frame, uint32_t lr);
+
+/* Raw cycle counter, cheap enough for timestamps. No overflow handling */
+static inline uint32_t _perfmon_ccnt(void)
+{
+    uint32_t ccnt;
+
+    asm volatile("mrc p15, 0, %[out], c9, c13, 0" : [out] "=r"(ccnt));
+    return ccnt;
+}
 #endif
@@ -0,0 +1,211 @@
+/*******************************************************************************
+ *
+ * bench.c
+ *
+ * Micro-benchmark harness. Every benchmark in benchSuite[] (suite.c) is
+ * warmed up, then each timed iteration is bracketed by PMU snapshots. The
+ * cost of an empty iteration is measured once at start up and taken off.
+ * Results go to the console one line per benchmark:
+ *
+ *   BENCH name=<s> iters=<n> bytes=<n> cycles_min=<n> cycles_med=<n>
+ *         cycles_max=<n> <event>=<median> ...
+ *
+ * Each event median is taken on its own, so they don't necessarily come
+ * from the same iteration as cycles_med. Benchmarks that can't run (no SD
+ * card) print "BENCH name=<s> skipped" and the run ends with
+ * "BENCH DONE ran=<n> skipped=<n>".
+ *
+ * Copyright (C) 2013 Paul Quevedo
+ *
+ * This program is free software.  It comes without any warranty, to the extent
+ * permitted by applicable law.  You can redistribute it and/or modify it under
+ * the terms of the WTF Public License (WTFPL), Version 2, as published by
+ * Sam Hocevar.  See http://sam.zoy.org/wtfpl/COPYING for more details.
+ *
+ *******************************************************************************/
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "arm/perfmon.h"
+
+#include "ch.h"
+
+#include "globalDefs.h"
+#include "hardware.h"
+#include "vfp.h"
+#include "bench.h"
+
+#ifndef BENCH_ITERS
+#define BENCH_ITERS 0       /* Use each benchmark's own count */
+#endif
+
+#define BENCH_METRICS  (1 + PERF_MON_MAX_COUNTERS)  /* Cycles + events */
+#define BENCH_PRIO     (HIGHPRIO - 2)   /* Above everything but suite.c's */
+
+static uint32_t samples[BENCH_METRICS][BENCH_MAX_ITERS];
+static uint32_t overhead[BENCH_METRICS];
+static uint32_t benchIters;
+
+static VFP_WORKING_AREA(waVfpBench, 1024);
+
+static int cmpU32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+static void benchNull(uint32_t arg)
+{
+}
+
+/*
+ * benchSample()
+ *
+ * Fills samples[] with iters timed calls of run, each metric sorted. A
+ * bench with measure() reports its own cycles, nothing is taken off them.
+ */
+static void benchSample(const bench_t *bench, uint32_t iters)
+{
+    perfmonSnapshot_t start;
+    perfmonSnapshot_t end;
+    uint32_t cycles = 0;
+    uint32_t i;
+    int m;
+
+    for (i = 0; i < BENCH_WARMUP; i++) {
+        if (bench->measure)
+            bench->measure(bench->arg);
+        else
+            bench->run(bench->arg);
+    }
+
+    for (i = 0; i < iters; i++) {
+        _perfmon_snapshot(&start);
+        if (bench->measure)
+            cycles = bench->measure(bench->arg);
+        else
+            bench->run(bench->arg);
+        _perfmon_snapshot(&end);
+
+        samples[0][i] = bench->measure ? cycles :
+                        (uint32_t)(end.cycles - start.cycles);
+        for (m = 1; m < BENCH_METRICS; m++)
+            samples[m][i] = (uint32_t)(end.events[m - 1] -
+                                       start.events[m - 1]);
+    }
+
+    for (m = 0; m < BENCH_METRICS; m++) {
+        uint32_t off = (m == 0 && bench->measure) ? 0 : overhead[m];
+
+        qsort(samples[m], iters, sizeof(uint32_t), cmpU32);
+        for (i = 0; i < iters; i++)
+            samples[m][i] = (samples[m][i] > off) ? samples[m][i] - off : 0;
+    }
+}
+
+static void benchCalibrate(void)
+{
+    const bench_t null = { .name = "null", .run = benchNull, };
+    int m;
+
+    for (m = 0; m < BENCH_METRICS; m++)
+        overhead[m] = 0;
+
+    benchSample(&null, BENCH_MAX_ITERS);
+    for (m = 0; m < BENCH_METRICS; m++)
+        overhead[m] = samples[m][BENCH_MAX_ITERS / 2];
+
+    iprintf("BENCH overhead cycles=%lu\n\r", overhead[0]);
+}
+
+/*
+ * benchBody()
+ *
+ * setup, benchIters samples and teardown, in whichever thread benchRun()
+ * picked
+ *
+ * RETURNS: OK, or ERROR if the benchmark's setup failed
+ */
+static msg_t benchBody(void *arg)
+{
+    const bench_t *bench = arg;
+
+    if (bench->setup && bench->setup(bench->arg) != OK)
+        return ERROR;
+
+    benchSample(bench, benchIters);
+
+    if (bench->teardown)
+        bench->teardown(bench->arg);
+    return OK;
+}
+
+/*
+ * benchRun()
+ *
+ * RETURNS: OK, or ERROR if the benchmark's setup failed
+ */
+int benchRun(const bench_t *bench)
+{
+    uint32_t iters = BENCH_ITERS ? BENCH_ITERS : bench->iters;
+    msg_t status;
+    int m;
+
+    LIMIT_VAL(iters, 1, BENCH_MAX_ITERS);
+    benchIters = iters;
+
+    /* Same priority, this thread only waits while the other runs */
+    if (bench->vfp)
+        status = chThdWait(vfpThdCreateStatic(waVfpBench, sizeof(waVfpBench),
+                                              BENCH_PRIO, benchBody,
+                                              (void *)bench));
+    else
+        status = benchBody((void *)bench);
+
+    if (status != OK) {
+        iprintf("BENCH name=%s skipped\n\r", bench->name);
+        uartDrain(UART_CONSOLE);
+        return ERROR;
+    }
+
+    iprintf("BENCH name=%s iters=%lu bytes=%lu"
+            " cycles_min=%lu cycles_med=%lu cycles_max=%lu",
+            bench->name, iters, bench->bytes,
+            samples[0][0], samples[0][iters / 2], samples[0][iters - 1]);
+    for (m = 1; m < BENCH_METRICS; m++)
+        if (perfMonNames[m - 1] != NULL)
+            iprintf(" %s=%lu", perfMonNames[m - 1], samples[m][iters / 2]);
+    iprintf("\n\r");
+
+    /* Don't let the uart irq run into the next benchmark */
+    uartDrain(UART_CONSOLE);
+
+    return OK;
+}
+
+int main(void)
+{
+    int ran = 0;
+    int i;
+
+    hwInit();
+    chThdSetPriority(BENCH_PRIO);
+    chThdSleepMilliseconds(100);    /* Let the boot LOG()s drain */
+
+    benchCalibrate();
+    for (i = 0; i < benchSuiteSize; i++)
+        if (benchRun(&benchSuite[i]) == OK)
+            ran++;
+
+    iprintf("BENCH DONE ran=%d skipped=%d\n\r", ran, benchSuiteSize - ran);
+
+    gpioConfig(HW_LED0_PORT, HW_LED0_PIN, GPIO_CFG_OUTPUT);
+    while (1) {
+        gpioToggle(HW_LED0_PORT, HW_LED0_PIN);
+        chThdSleepMilliseconds(500);
+    }
+
+    return 0;
+}
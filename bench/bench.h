@@ -0,0 +1,40 @@
+/*******************************************************************************
+ *
+ * bench.h
+ *
+ * Micro-benchmark harness. A benchmark is a run() hook timed one call at a
+ * time with the cycle counter and the hwInit() event counters, see bench.c.
+ *
+ * Copyright (C) 2013 Paul Quevedo
+ *
+ * This program is free software.  It comes without any warranty, to the extent
+ * permitted by applicable law.  You can redistribute it and/or modify it under
+ * the terms of the WTF Public License (WTFPL), Version 2, as published by
+ * Sam Hocevar.  See http://sam.zoy.org/wtfpl/COPYING for more details.
+ *
+ *******************************************************************************/
+#ifndef __BENCH_H__
+#define __BENCH_H__
+#include "globalDefs.h"
+
+#define BENCH_MAX_ITERS  256
+#define BENCH_WARMUP     4
+
+typedef struct {
+    const char *name;
+    int       (*setup)   (uint32_t arg); /* Optional, ERROR skips the run */
+    void      (*run)     (uint32_t arg); /* One timed iteration */
+    uint32_t  (*measure) (uint32_t arg); /* Or one that times itself, cycles */
+    void      (*teardown)(uint32_t arg); /* Optional */
+    uint32_t    arg;
+    uint32_t    bytes;      /* Per iteration, 0 if throughput is meaningless */
+    uint32_t    iters;      /* Timed iterations, up to BENCH_MAX_ITERS */
+    bool32_t    vfp;        /* Run in a vfpThdCreateStatic() thread */
+} bench_t;
+
+/* suite.c */
+extern const bench_t benchSuite[];
+extern const int     benchSuiteSize;
+
+extern int benchRun(const bench_t *bench);
+#endif
@@ -0,0 +1,373 @@
+/*******************************************************************************
+ *
+ * suite.c
+ *
+ * The benchmarks. Add an entry to benchSuite[] to register a new one.
+ *
+ * Copyright (C) 2013 Paul Quevedo
+ *
+ * This program is free software.  It comes without any warranty, to the extent
+ * permitted by applicable law.  You can redistribute it and/or modify it under
+ * the terms of the WTF Public License (WTFPL), Version 2, as published by
+ * Sam Hocevar.  See http://sam.zoy.org/wtfpl/COPYING for more details.
+ *
+ *******************************************************************************/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "arm/asm.h"
+#include "arm/perfmon.h"
+
+#include "ch.h"
+
+#include "globalDefs.h"
+#include "am335x.h"
+#include "hardware.h"
+#include "clock.h"
+#include "crc.h"
+#include "sdhc.h"
+#include "vfp.h"
+#include "bench.h"
+#include "vfpcheck.h"
+
+#define BUF_SIZE 65536
+#define BUF_SLACK 64    /* Room for the misaligned copies */
+
+static uint8_t srcBuf[BUF_SIZE + BUF_SLACK] __attribute__ ((aligned (64)));
+static uint8_t dstBuf[BUF_SIZE + BUF_SLACK] __attribute__ ((aligned (64)));
+static uint8_t dmaBuf[BUF_SIZE] DMA_BSS;
+
+/****************************
+ * memcpy / memset / crc32
+ ****************************/
+/* arg for the string benchmarks: a multiple of 64 bytes, plus the src and
+ * dst offsets from a cache line in the low bits */
+#define MEM_ARG(size, srcOff, dstOff)   ((size) | (srcOff) | ((dstOff) << 3))
+#define MEM_SIZE(arg)                   ((arg) & ~0x3f)
+#define MEM_SRC(arg)                    (srcBuf + ((arg) & 0x7))
+#define MEM_DST(arg)                    (dstBuf + (((arg) >> 3) & 0x7))
+
+static int bufSetup(uint32_t arg)
+{
+    uint32_t i;
+
+    for (i = 0; i < sizeof(srcBuf); i++)
+        srcBuf[i] = i * 7;
+
+    return OK;
+}
+
+static void memcpyRun(uint32_t arg)
+{
+    memcpy(MEM_DST(arg), MEM_SRC(arg), MEM_SIZE(arg));
+}
+
+static void memsetRun(uint32_t arg)
+{
+    memset(MEM_DST(arg), 0x5a, MEM_SIZE(arg));
+}
+
+static volatile int cmpResult;
+
+/* Equal buffers, the worst case */
+static int memcmpSetup(uint32_t arg)
+{
+    bufSetup(arg);
+    memcpy(dstBuf, srcBuf, sizeof(dstBuf));
+    return OK;
+}
+
+static void memcmpRun(uint32_t arg)
+{
+    cmpResult = memcmp(MEM_DST(arg), MEM_SRC(arg), MEM_SIZE(arg));
+}
+
+/* NEON benchmarks set .vfp, the first VLD traps into vfpTrap() like any
+ * other VFP thread's would */
+static void memcpyNeonRun(uint32_t arg)
+{
+    _memcpy_neon(MEM_DST(arg), MEM_SRC(arg), MEM_SIZE(arg));
+}
+
+static void memsetNeonRun(uint32_t arg)
+{
+    _memset_neon(MEM_DST(arg), 0x5a, MEM_SIZE(arg));
+}
+
+static volatile uint32_t crcResult; /* Keeps the call from being dropped */
+
+static void crcRun(uint32_t size)
+{
+    crcResult = crc32(0, srcBuf, size);
+}
+
+/****************************
+ * Store bandwidth
+ ****************************/
+/* Word stores through cached DDR (write-back, or DDR_CACHE=WT) and through
+ * the uncached DMA_BSS window */
+static void storeRun(uint32_t *buf, uint32_t size)
+{
+    uint32_t *end = buf + size / 4;
+
+    while (buf < end) {
+        buf[0] = 0; buf[1] = 0; buf[2] = 0; buf[3] = 0;
+        buf += 4;
+    }
+}
+
+static void storeDdrRun(uint32_t size)
+{
+    storeRun((uint32_t *)dstBuf, size);
+}
+
+static void storeDmaRun(uint32_t size)
+{
+    storeRun((uint32_t *)dmaBuf, size);
+}
+
+/****************************
+ * SD block read
+ ****************************/
+static sdhcCard_t sdCard;
+static bool32_t   sdOpen;
+
+static int sdSetup(uint32_t block)
+{
+    if (sdOpen)
+        return OK;
+
+    sdCard.inst = SDHC_0;
+    if (sdhcInit(sdCard.inst) != OK || !sdhcCardPresent(sdCard.inst))
+        return ERROR;
+    if (sdhcOpen(&sdCard) != OK)
+        return ERROR;
+
+    sdOpen = TRUE;
+    return OK;
+}
+
+static void sdReadRun(uint32_t block)
+{
+    sdhcReadBlock(&sdCard, block, (uint32_t *)dstBuf);
+}
+
+/****************************
+ * Interrupt latency
+ ****************************/
+/* Reserved INTC lines, only ever raised by hand through INTC_ISR_SET */
+#define IRQ_SW_LOW      5
+#define IRQ_SW_HIGH     6
+#define IRQ_BUSY_US     50      /* A long, low priority handler */
+
+static volatile uint32_t irqRaised;     /* Cycle count at INTC_ISR_SET */
+static volatile uint32_t irqEntered;    /* and in the high priority ISR */
+static volatile bool32_t irqHighDone;
+static volatile bool32_t irqLowDone;
+
+static void irqRaise(uint32_t irq)
+{
+    irqRaised = _perfmon_ccnt();
+    INTC_ISR_SET(irq / 32) = 1 << (irq & 0x1f);
+}
+
+static void irqHighISR(void)
+{
+    irqEntered = _perfmon_ccnt();
+    hwClearIRQ(IRQ_SW_HIGH);
+    irqHighDone = TRUE;
+}
+
+static void irqLowISR(void)
+{
+    hwClearIRQ(IRQ_SW_LOW);
+    irqRaise(IRQ_SW_HIGH);
+    clockDelayUs(IRQ_BUSY_US);
+    irqLowDone = TRUE;
+}
+
+static int irqSetup(uint32_t arg)
+{
+    hwInstallIRQ(IRQ_SW_LOW,  irqLowISR,  INT_PRIORITY_LOW);
+    hwInstallIRQ(IRQ_SW_HIGH, irqHighISR, INT_PRIORITY_HIGH);
+    return OK;
+}
+
+/* Raised from a thread */
+static uint32_t irqLatency(uint32_t arg)
+{
+    irqHighDone = FALSE;
+    irqRaise(IRQ_SW_HIGH);
+    while (!irqHighDone)
+        ;
+    return irqEntered - irqRaised;
+}
+
+/* irq_latency on the fast path */
+static int irqFastSetup(uint32_t arg)
+{
+    return hwInstallFastIRQ(IRQ_SW_HIGH, irqHighISR);
+}
+
+static void irqFastTeardown(uint32_t arg)
+{
+    hwInstallIRQ(IRQ_SW_HIGH, irqHighISR, INT_PRIORITY_HIGH);
+}
+
+/* Raised from inside a low priority ISR, IRQ_BUSY_US without nesting */
+static uint32_t irqLatencyNested(uint32_t arg)
+{
+    irqHighDone = FALSE;
+    irqLowDone  = FALSE;
+    irqRaise(IRQ_SW_LOW);
+    while (!irqHighDone || !irqLowDone)
+        ;
+    return irqEntered - irqRaised;
+}
+
+/****************************
+ * Context switch
+ ****************************/
+/* Round trip through a higher priority thread, two switches per run */
+static Thread *pongThread;
+
+static WORKING_AREA(waPong, 256);
+static msg_t pong(void *arg)
+{
+    chRegSetThreadName("pong");
+
+    while (TRUE) {
+        Thread *tp = chMsgWait();
+        chMsgRelease(tp, 0);
+    }
+    return 0;
+}
+
+static int pingSetup(uint32_t arg)
+{
+    if (pongThread == NULL)
+        pongThread = chThdCreateStatic(waPong, sizeof(waPong), HIGHPRIO - 1,
+                                       pong, NULL);
+    return OK;
+}
+
+static void pingRun(uint32_t arg)
+{
+    chMsgSend(pongThread, 0);
+}
+
+/****************************
+ * VFP context switch
+ ****************************/
+/* Two vfpcheck.c threads, VFP_CHECK_YIELDS switches each per run */
+static vfpCheck_t vfpChecks[2];
+static VFP_WORKING_AREA(waVfpCheck0, 256);
+static VFP_WORKING_AREA(waVfpCheck1, 256);
+static bool32_t vfpCheckStarted;
+
+static int vfpCheckSetup(uint32_t arg)
+{
+    int i;
+
+    if (vfpCheckStarted)
+        return OK;
+
+    for (i = 0; i < 2; i++) {
+        chSemInit(&vfpChecks[i].go, 0);
+        chSemInit(&vfpChecks[i].done, 0);
+        vfpChecks[i].seed   = 0x5a5a0000 * (i + 1);
+        vfpChecks[i].errors = 0;
+    }
+    vfpThdCreateStatic(waVfpCheck0, sizeof(waVfpCheck0), HIGHPRIO - 1,
+                       vfpCheckThread, &vfpChecks[0]);
+    vfpThdCreateStatic(waVfpCheck1, sizeof(waVfpCheck1), HIGHPRIO - 1,
+                       vfpCheckThread, &vfpChecks[1]);
+    vfpCheckStarted = TRUE;
+
+    return OK;
+}
+
+/* Both made ready together, otherwise the first would yield to nobody */
+static void vfpCheckRun(uint32_t arg)
+{
+    chSysLock();
+    chSemSignalI(&vfpChecks[0].go);
+    chSemSignalI(&vfpChecks[1].go);
+    chSchRescheduleS();
+    chSysUnlock();
+
+    chSemWait(&vfpChecks[0].done);
+    chSemWait(&vfpChecks[1].done);
+}
+
+static void vfpCheckTeardown(uint32_t arg)
+{
+    uint32_t errors = vfpChecks[0].errors + vfpChecks[1].errors;
+
+    if (errors)
+        iprintf("BENCH vfp_switch lost %lu registers\n\r", errors);
+}
+
+/****************************
+ * Suite
+ ****************************/
+const bench_t benchSuite[] = {
+    { .name = "memcpy_64",   .setup = bufSetup, .run = memcpyRun,
+      .arg = 64,    .bytes = 64,    .iters = 256, },
+    { .name = "memcpy_4k",   .setup = bufSetup, .run = memcpyRun,
+      .arg = 4096,  .bytes = 4096,  .iters = 128, },
+    { .name = "memcpy_64k",  .setup = bufSetup, .run = memcpyRun,
+      .arg = 65536, .bytes = 65536, .iters = 32, },
+    { .name = "memcpy_4k_s1", .setup = bufSetup, .run = memcpyRun,
+      .arg = MEM_ARG(4096, 1, 0), .bytes = 4096, .iters = 128, },
+    { .name = "memcpy_4k_s2", .setup = bufSetup, .run = memcpyRun,
+      .arg = MEM_ARG(4096, 2, 0), .bytes = 4096, .iters = 128, },
+    { .name = "memcpy_4k_d3", .setup = bufSetup, .run = memcpyRun,
+      .arg = MEM_ARG(4096, 0, 3), .bytes = 4096, .iters = 128, },
+    { .name = "memcpy_4k_s3d3", .setup = bufSetup, .run = memcpyRun,
+      .arg = MEM_ARG(4096, 3, 3), .bytes = 4096, .iters = 128, },
+    { .name = "memcpy_neon_4k", .setup = bufSetup, .run = memcpyNeonRun,
+      .vfp = TRUE,
+      .arg = 4096,  .bytes = 4096,  .iters = 128, },
+    { .name = "memcpy_neon_64k", .setup = bufSetup, .run = memcpyNeonRun,
+      .vfp = TRUE,
+      .arg = 65536, .bytes = 65536, .iters = 32, },
+    { .name = "memcpy_neon_4k_s1", .setup = bufSetup, .run = memcpyNeonRun,
+      .vfp = TRUE,
+      .arg = MEM_ARG(4096, 1, 0), .bytes = 4096, .iters = 128, },
+    { .name = "memset_4k",   .run = memsetRun,
+      .arg = 4096,  .bytes = 4096,  .iters = 128, },
+    { .name = "memset_64k",  .run = memsetRun,
+      .arg = 65536, .bytes = 65536, .iters = 32, },
+    { .name = "memset_4k_d1", .run = memsetRun,
+      .arg = MEM_ARG(4096, 0, 1), .bytes = 4096, .iters = 128, },
+    { .name = "memset_neon_64k", .run = memsetNeonRun, .vfp = TRUE,
+      .arg = 65536, .bytes = 65536, .iters = 32, },
+    { .name = "memcmp_4k",   .setup = memcmpSetup, .run = memcmpRun,
+      .arg = 4096,  .bytes = 4096,  .iters = 128, },
+    { .name = "store_4k",    .run = storeDdrRun,
+      .arg = 4096,  .bytes = 4096,  .iters = 128, },
+    { .name = "store_64k",   .run = storeDdrRun,
+      .arg = 65536, .bytes = 65536, .iters = 32, },
+    { .name = "store_64k_dma", .run = storeDmaRun,
+      .arg = 65536, .bytes = 65536, .iters = 32, },
+    { .name = "crc32_4k",    .setup = bufSetup, .run = crcRun,
+      .arg = 4096,  .bytes = 4096,  .iters = 128, },
+    { .name = "sd_read_blk", .setup = sdSetup,  .run = sdReadRun,
+      .arg = 0,     .bytes = 512,   .iters = 64, },
+    { .name = "irq_latency", .setup = irqSetup, .measure = irqLatency,
+      .arg = 0,     .bytes = 0,     .iters = 256, },
+    { .name = "irq_latency_busy", .setup = irqSetup,
+      .measure = irqLatencyNested,
+      .arg = 0,     .bytes = 0,     .iters = 64, },
+    { .name = "irq_latency_fast", .setup = irqFastSetup,
+      .measure = irqLatency, .teardown = irqFastTeardown,
+      .arg = 0,     .bytes = 0,     .iters = 256, },
+    { .name = "ctx_switch",  .setup = pingSetup, .run = pingRun,
+      .arg = 0,     .bytes = 0,     .iters = 256, },
+    { .name = "vfp_switch",  .setup = vfpCheckSetup, .run = vfpCheckRun,
+      .teardown = vfpCheckTeardown,
+      .arg = 0,     .bytes = 0,     .iters = 64, },
+};
+const int benchSuiteSize = ARRAY_SIZE(benchSuite);
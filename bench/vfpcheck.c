@@ -0,0 +1,63 @@
+/*******************************************************************************
+ *
+ * vfpcheck.c
+ *
+ * Built with NEON code generation (VFP_PIECES), so nothing in here may run
+ * outside a vfpThdCreateStatic() thread.
+ *
+ * Each round the thread keeps a float vector sum live across its yields, the
+ * way compiled code holds values in d8-d15, and has _vfp_check() fill every
+ * register with its seed across each yield. Two threads at one priority,
+ * both ready, take turns on the VFP at every yield, so a lost or swapped
+ * context shows up in errors.
+ *
+ * Copyright (C) 2013 Paul Quevedo
+ *
+ * This program is free software.  It comes without any warranty, to the extent
+ * permitted by applicable law.  You can redistribute it and/or modify it under
+ * the terms of the WTF Public License (WTFPL), Version 2, as published by
+ * Sam Hocevar.  See http://sam.zoy.org/wtfpl/COPYING for more details.
+ *
+ *******************************************************************************/
+#include <stdint.h>
+#include <arm_neon.h>
+#include "arm/asm.h"
+
+#include "ch.h"
+
+#include "globalDefs.h"
+#include "vfpcheck.h"
+
+msg_t vfpCheckThread(void *arg)
+{
+    static const float steps[4] = { 0.5f, 1.0f, 1.5f, 2.0f };
+    vfpCheck_t *check = arg;
+    float32x4_t step = vld1q_f32(steps);
+    float32x4_t sum;
+    float32x4_t want;
+    uint32x4_t same;
+    int i;
+
+    chRegSetThreadName("vfpcheck");
+
+    while (TRUE) {
+        chSemWait(&check->go);
+
+        /* Small multiples of 0.5, exact in single precision */
+        sum = vdupq_n_f32((float)(check->seed & 0xff));
+        for (i = 0; i < VFP_CHECK_YIELDS; i++) {
+            sum = vaddq_f32(sum, step);
+            check->errors += _vfp_check(check->seed + i, chThdYield);
+        }
+
+        want = vmlaq_n_f32(vdupq_n_f32((float)(check->seed & 0xff)),
+                           step, (float)VFP_CHECK_YIELDS);
+        same = vceqq_f32(sum, want);
+        if ((vgetq_lane_u32(same, 0) & vgetq_lane_u32(same, 1) &
+             vgetq_lane_u32(same, 2) & vgetq_lane_u32(same, 3)) == 0)
+            check->errors++;
+
+        chSemSignal(&check->done);
+    }
+    return 0;
+}
@@ -0,0 +1,30 @@
+/*******************************************************************************
+ *
+ * vfpcheck.h
+ *
+ * Two vfpThdCreateStatic() threads handing the VFP back and forth, see
+ * vfpcheck.c. suite.c drives them as the vfp_switch benchmark.
+ *
+ * Copyright (C) 2013 Paul Quevedo
+ *
+ * This program is free software.  It comes without any warranty, to the extent
+ * permitted by applicable law.  You can redistribute it and/or modify it under
+ * the terms of the WTF Public License (WTFPL), Version 2, as published by
+ * Sam Hocevar.  See http://sam.zoy.org/wtfpl/COPYING for more details.
+ *
+ *******************************************************************************/
+#ifndef __VFPCHECK_H__
+#define __VFPCHECK_H__
+#include "ch.h"
+
+#define VFP_CHECK_YIELDS    8   /* Per round, each one a VFP switch */
+
+typedef struct {
+    Semaphore go;       /* Signalled once per round */
+    Semaphore done;
+    uint32_t  seed;     /* Different for each thread */
+    uint32_t  errors;   /* Registers or results found changed, never reset */
+} vfpCheck_t;
+
+extern msg_t vfpCheckThread(void *arg);
+#endif
@@ -18,14 +18,44 @@
 #include "globalDefs.h"
 #include "am335x.h"
 #include "hardware.h"
+#include "clock.h"
 #include "ff.h"
 #include "xmodem.h"
-
-static void delay(volatile uint32_t count)
-{
-    while (count--)
-        ;
-}
+#include "smodem.h"
+#include "memtest.h"
+#include "bootprof.h"
+#include "bootcfg.h"
+#include "bootinfo.h"
+
+/* Console rate, and the rate SMODEM offers the sender for image upload.
+ * 921600 is 0.16% off in 13x mode and within reach of the FT2232 on the
+ * board. Anything uartBaudCalc() accepts up to 3686400 works here */
+#define BOOT_CONSOLE_BAUD BAUD_115200
+#define BOOT_XFER_RATE    921600
+
+#define BOOT_DDR_SETTLE_US  200     /* DDR2 needs 200us of stable clock */
+#define BOOT_BLINK_US       250000
+#define BOOT_COUNTDOWN_US   500000  /* Per Tick..., 2.5s to press a key */
+#define BOOT_IDLE_BLINK_US  100000
+#define BOOT_PROTO_WAIT_US  3000000 /* No key by then, XMODEM like before */
+
+/* DDR2 on the board, all of it tested before the image is loaded into it.
+ * make MEMTEST=FULL checks every word (a few seconds), the default quick
+ * pass checks the buses and samples each region for ~BOOT_MEMTEST_US */
+#define BOOT_DDR_BASE       0x80000000
+#define BOOT_DDR_SIZE       0x10000000
+
+/* Images load below BOOTINFO, which has to be in DDR for that to hold */
+#define BOOT_IMAGE_END      BOOTINFO_ADDR
+#if BOOT_IMAGE_END > BOOT_DDR_BASE + BOOT_DDR_SIZE
+#error BOOTINFO_ADDR is past the end of DDR
+#endif
+#define BOOT_MEMTEST_US     5000
+#if BOOT_MEMTEST_FULL
+#define BOOT_MEMTEST_MODE   MEMTEST_FULL
+#else
+#define BOOT_MEMTEST_MODE   MEMTEST_QUICK
+#endif
 
 static void pllCoreInit(void)
 {
@@ -280,7 +310,7 @@ static void ddr2Init(void)
     EMIF_SDRAM_REF_CTRL      = 0x00004650;
     EMIF_SDRAM_REF_CTRL_SHDW = 0x00004650;
 
-    delay(5000);
+    clockDelayUs(BOOT_DDR_SETTLE_US);
 
     EMIF_SDRAM_REF_CTRL      = 0x0000081A;
     EMIF_SDRAM_REF_CTRL_SHDW = 0x0000081A;
@@ -291,15 +321,23 @@ static void ddr2Init(void)
 
 static int ddrtest(void)
 {
-    volatile uint32_t *dstPtr = (volatile uint32_t *)0x80000000;
-    while ((uint32_t)dstPtr < 0x8FA00000) {
-        *dstPtr = 0x12345678;
-        if (*dstPtr != 0x12345678) {
-            return ERROR;
-        }
-        dstPtr += 0x40;
-    }
-    return OK;
+    static const memtestCfg_t cfg = {
+        .base     = BOOT_DDR_BASE,
+        .size     = BOOT_DDR_SIZE,
+        .mode     = BOOT_MEMTEST_MODE,
+        .budgetUs = BOOT_MEMTEST_US,
+    };
+    memtestResult_t result;
+    int status;
+
+    status = memtest(&cfg, &result);
+    if (status != OK)
+        iprintf("%s failed at %08x wrote %08x read %08x\n\r",
+                result.test, result.addr, result.expected, result.actual);
+    iprintf("%s test, %d KB patterned in %d us\n\r",
+            cfg.mode == MEMTEST_FULL ? "Full" : "Quick",
+            result.covered / 1024, result.us);
+    return status;
 }
 
 
@@ -311,8 +349,6 @@ static uint32_t imageCopy(void)
     FRESULT result;
     uint32_t imageSize;
     uint32_t loadAddr;
-    uint32_t *dstPtr;
-    static uint32_t buffer[512];
 
     memset(&fp, 0, sizeof(fp));
 
@@ -341,25 +377,31 @@ static uint32_t imageCopy(void)
         uartPuts("Warning: Load location is not beginning of DDR");
     }
 
+    /* Nothing gets jumped to that runs into BOOTINFO or off DDR. With the
+     * MMU off DDR is strongly ordered and sdhcReadBlock stores words, so
+     * an unaligned load address would fault mid copy */
+    if (imageSize < 8 || (loadAddr & 3) ||
+        loadAddr < BOOT_DDR_BASE || loadAddr >= BOOT_IMAGE_END ||
+        imageSize - 8 > BOOT_IMAGE_END - loadAddr) {
+        uartPuts("Application header doesn't fit DDR");
+        f_close(&fp);
+        return BAD_ADDRESS;
+    }
+
     imageSize -= 8; /* Remove header info */
 #if DEBUG
     iprintf("Loading to addr %08x size %x\n\r", loadAddr, imageSize);
 #else
     uartPuts("Image loading...");
 #endif
-    dstPtr = (uint32_t *)loadAddr;
-
-    while (imageSize) {
-        uint32_t chunk = (imageSize > 512) ? 512 : imageSize;
-        if (f_read(&fp, buffer, chunk, &bytesRead) != FR_OK
-                                     || bytesRead  != chunk) {
-            uartPuts("Failed to read a chunk");
-            f_close(&fp);
-            return BAD_ADDRESS;
-        }
-        memcpy(dstPtr, buffer, chunk);
-        dstPtr    += (chunk / 4);
-        imageSize -= chunk;
+
+    /* Straight into DDR. Past the header's partial sector FatFs reads
+     * whole sectors into the destination, no copy through a buffer */
+    if (f_read(&fp, (void *)loadAddr, imageSize, &bytesRead) != FR_OK
+                                         || bytesRead != imageSize) {
+        uartPuts("Failed to read the image");
+        f_close(&fp);
+        return BAD_ADDRESS;
     }
 
     f_close(&fp);
@@ -381,20 +423,43 @@ static bool32_t isImagePresent(void)
     return (result == FR_OK);
 }
 
-static int32_t loadNewImage(void)
+typedef enum {
+    XFER_XMODEM,
+    XFER_SMODEM,
+} xferProto_t;
+
+static int32_t loadNewImage(xferProto_t proto)
 {
     static uint8_t rxBuffer[1024];
     xmodemCfg_t xmodemCfg = {
         .numRetries = 0x2000,
         .uartFd = UART_CONSOLE,
     };
+    smodemCfg_t smodemCfg = {
+        .numRetries = 0x2000,
+        .uartFd = UART_CONSOLE,
+        .window = SMODEM_MAX_WINDOW,
+        .baseRate = uartBaudRate(BOOT_CONSOLE_BAUD),
+        .xferRate = BOOT_XFER_RATE,
+    };
+    int32_t (*xferRecv)(uint8_t *outBuffer, uint32_t numBytes);
+    int32_t (*xferAbort)(void);
 
     FIL fp;
     UINT bytesWritten;
     int32_t retVal = OK;
     int xferStarted = FALSE;
 
-    xmodemInit(&xmodemCfg);
+    if (proto == XFER_SMODEM) {
+        smodemInit(&smodemCfg);
+        xferRecv  = smodemRecv;
+        xferAbort = smodemAbort;
+    }
+    else {
+        xmodemInit(&xmodemCfg);
+        xferRecv  = xmodemRecv;
+        xferAbort = xmodemAbort;
+    }
 
     if (f_open(&fp, "/app_tmp", FA_WRITE | FA_CREATE_ALWAYS) != FR_OK) {
         uartPuts("Failed to create file");
@@ -402,10 +467,21 @@ static int32_t loadNewImage(void)
     }
     f_lseek(&fp, 0);
 
-    uartPuts("Waiting for XMODEM Transfer to begin");
+    if (proto == XFER_SMODEM) {
+#if DEBUG
+        uartBaud_t baud;
+        uartBaudCalc(BOOT_XFER_RATE, &baud);
+        iprintf("Offering %d baud (%s mode, div %d, error %d ppm)\n\r",
+                BOOT_XFER_RATE, baud.mode == UART_MDR1_MODE_13X ? "13x" : "16x",
+                baud.divisor, baud.errorPpm);
+#endif
+        uartPuts("Waiting for SMODEM Transfer to begin");
+    }
+    else
+        uartPuts("Waiting for XMODEM Transfer to begin");
 
     while (1) {
-        int len = xmodemRecv(rxBuffer, sizeof(rxBuffer));
+        int len = xferRecv(rxBuffer, sizeof(rxBuffer));
 
         if (len == 0) {
             uartPuts("Programming succesfull!");
@@ -415,14 +491,14 @@ static int32_t loadNewImage(void)
             xferStarted = TRUE;
             if (f_write(&fp, rxBuffer, len, &bytesWritten) != FR_OK
                                           || bytesWritten  != len) {
-                xmodemAbort();
+                xferAbort();
                 uartPuts("Failed to write chunk");
                 retVal = ERROR;
                 break;
             }
         }
         else if (xferStarted) {
-            xmodemAbort();
+            xferAbort();
             uartPuts("Error in transfer");
             retVal = ERROR;
             break;
@@ -467,16 +543,43 @@ static int32_t loadNewImage(void)
     return retVal;
 }
 
+/*
+ * memtestDue()
+ *
+ * memtest=cold tests on a cold boot, when the warm boot count was lost
+ * (warmBoots 0 either way) and every memtestEvery warm boots after
+ */
+static bool32_t memtestDue(const bootCfg_t *cfg, uint32_t warmBoots)
+{
+    switch (cfg->memtest) {
+    case BOOTCFG_MEMTEST_NEVER:
+        return FALSE;
+    case BOOTCFG_MEMTEST_COLD:
+        return warmBoots == 0 ||
+               (cfg->memtestEvery && warmBoots % cfg->memtestEvery == 0);
+    default:
+        return TRUE;
+    }
+}
+
+/* smsend sends 's' until the receiver answers, anything else is XMODEM */
+static xferProto_t selectProto(uint8_t key)
+{
+    return (key == 's' || key == 'S') ? XFER_SMODEM : XFER_XMODEM;
+}
 
 int main(void)
 {
     uartCfg_t uartCfg = {
-        .baud = BAUD_115200,
+        .baud = BOOT_CONSOLE_BAUD,
         .fifo = { .enable = TRUE,
                   .rxTrig = 1,
                   .txTrig = 1, },
     };
     bool32_t imagePresent;
+    bootCfg_t bootCfg;
+    uint32_t resetCause;
+    uint32_t warmBoots;
     FATFS fatfs;
 
     /* Disable watchdog */
@@ -506,55 +609,86 @@ int main(void)
     /* Enable control module clock */
     CM_MODULEMODE_ENABLE(CM_WKUP_CONTROL_CLKCTRL);
 
+    clockInit();    /* Off the crystal, good before the PLLs are */
+
+    bootStage("pll");
     pllCoreInit();
     pllPerInit();
     pllMpuInit();
     pllDDRInit();
+    bootStage("ddr_init");
     emifInit();
     ddr2Init();
+    bootStage("console");
     uartConfig(UART_CONSOLE, &uartCfg);
 
     gpioConfig(HW_LED0_PORT, HW_LED0_PIN, GPIO_CFG_OUTPUT);
     gpioConfig(HW_LED1_PORT, HW_LED1_PIN, GPIO_CFG_OUTPUT);
 
     uartPuts("AM355x BeagleBone Bootloader");
-    uartPuts("Executing DDR Test...");
-
-    gpioSet(HW_LED1_PORT, HW_LED1_PIN);
-    if (ddrtest() != ERROR) {
-        uartPuts("DDR OK");
-        gpioClear(HW_LED1_PORT, HW_LED1_PIN);
-    } else {
-        uartPuts("DDR ERROR");
-        while (1) {
-            gpioToggle(HW_LED1_PORT, HW_LED1_PIN);
-            delay(0x4FFFF);
-        }
-    }
 
+    resetCause = PRM_RSTST;
+    PRM_RSTST  = resetCause;    /* Clear, the next boot sees only its own */
+    warmBoots  = bootWarmCount(resetCause);
+
+    /* Mounted ahead of the DDR test for /BOOTCFG, FatFs only needs SRAM */
+    bootStage("mount");
     memset(&fatfs, 0, sizeof(fatfs));
     if (f_mount(0, &fatfs) != FR_OK) {
         uartPuts("Failed to mount SD Card");
         while (1) {
             gpioToggle(HW_LED1_PORT, HW_LED1_PIN);
-            delay(0x4FFFF);
+            clockDelayUs(BOOT_BLINK_US);
+        }
+    }
+    if (bootCfgLoad(&bootCfg) == OK)
+        iprintf("bootcfg: fastboot %d memtest %d every %d, warm boot %d\n\r",
+                bootCfg.fastboot, bootCfg.memtest, bootCfg.memtestEvery,
+                warmBoots);
+
+    if (memtestDue(&bootCfg, warmBoots)) {
+        bootStage("memtest");
+        uartPuts("Executing DDR Test...");
+        gpioSet(HW_LED1_PORT, HW_LED1_PIN);
+        if (ddrtest() != ERROR) {
+            uartPuts("DDR OK");
+            gpioClear(HW_LED1_PORT, HW_LED1_PIN);
+        } else {
+            uartPuts("DDR ERROR");
+            while (1) {
+                gpioToggle(HW_LED1_PORT, HW_LED1_PIN);
+                clockDelayUs(BOOT_BLINK_US);
+            }
         }
     }
 
     if (isImagePresent()) {
         uint8_t c;
         int i;
-        uartPuts("Press any key to transfer new image...");
-
-        for (i = 4; i >= 0; i--) {
-            if (i)
-                uartPuts("Tick...");
-            else
-                uartPuts("Tock!");
-            delay(0x1FFFFF);
+
+        if (bootCfg.fastboot) {
+            /* Only what came in while mounting and testing, a break
+             * arrives as a 0 byte */
             if (uartRead(UART_CONSOLE, &c, 1) == 1) {
-                loadNewImage();
-                break;
+                bootStage("image_xfer");
+                loadNewImage(selectProto(c));
+            }
+        }
+        else {
+            bootStage("countdown");
+            uartPuts("Press any key to transfer new image (s for SMODEM)...");
+
+            for (i = 4; i >= 0; i--) {
+                if (i)
+                    uartPuts("Tick...");
+                else
+                    uartPuts("Tock!");
+                clockDelayUs(BOOT_COUNTDOWN_US);
+                if (uartRead(UART_CONSOLE, &c, 1) == 1) {
+                    bootStage("image_xfer");
+                    loadNewImage(selectProto(c));
+                    break;
+                }
             }
         }
     }
@@ -562,16 +696,30 @@ int main(void)
     imagePresent = isImagePresent();
     while(1) {
         if (!imagePresent) {
-            uartPuts("No image detected. Waiting for file transfer...");
-
-            imagePresent = loadNewImage() != ERROR;
+            uint64_t end = clockNow() +
+                           (uint64_t)BOOT_PROTO_WAIT_US * CLOCK_TICKS_PER_US;
+            uint8_t c = 0;
+
+            /* A plain XMODEM sender (sx) sends nothing until it hears the
+             * receiver, so it gets one without a key after a few seconds */
+            uartPuts("No image detected. Waiting for file transfer"
+                     " (s for SMODEM)...");
+            while (uartRead(UART_CONSOLE, &c, 1) != 1 && clockNow() < end)
+                ;
+
+            bootStage("image_xfer");
+            imagePresent = loadNewImage(selectProto(c)) != ERROR;
         }
 
         if (imagePresent) {
-            void (*imgPtr)() = (void *)imageCopy();
+            void (*imgPtr)();
 
+            bootStage("image_load");
+            imgPtr = (void *)imageCopy();
             if ((uint32_t)imgPtr != BAD_ADDRESS) {
+                bootHandoff();
                 uartPuts("Jumping to Application");
+                uartDrain(UART_CONSOLE); /* App resets the FIFOs */
                 (*imgPtr)();
             }
             uartPuts("Failed to load image");
@@ -579,7 +727,7 @@ int main(void)
         }
 
         gpioToggle(HW_LED0_PORT, HW_LED0_PIN);
-        delay(0x6FFFF);
+        clockDelayUs(BOOT_IDLE_BLINK_US);
     }
 
     return 0;
@@ -0,0 +1,127 @@
+/*******************************************************************************
+ *
+ * bootcfg.c
+ *
+ * Boot options, read from /BOOTCFG on the SD card. One key=value a line,
+ * # to the end of a line is a comment:
+ *
+ *   fastboot=1         skip the countdown, a key or break already sent
+ *                      still gets the transfer prompt
+ *   memtest=cold       always (default), cold or never
+ *   memtest_every=50   with memtest=cold, also every 50th warm boot
+ *
+ * No file means the defaults, the attended boot with a countdown and a
+ * DDR test every time.
+ *
+ * Copyright (C) 2013 Paul Quevedo
+ *
+ * This program is free software.  It comes without any warranty, to the extent
+ * permitted by applicable law.  You can redistribute it and/or modify it under
+ * the terms of the WTF Public License (WTFPL), Version 2, as published by
+ * Sam Hocevar.  See http://sam.zoy.org/wtfpl/COPYING for more details.
+ *
+ *******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "globalDefs.h"
+#include "ff.h"
+#include "bootcfg.h"
+
+#define BOOTCFG_MAX_SIZE 512
+
+static char *trim(char *str)
+{
+    char *end;
+
+    while (*str == ' ' || *str == '\t')
+        str++;
+    end = str + strlen(str);
+    while (end > str && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r'))
+        *--end = '\0';
+    return str;
+}
+
+static int bootCfgSet(bootCfg_t *cfg, const char *key, const char *value)
+{
+    if (strcmp(key, "fastboot") == 0) {
+        cfg->fastboot = strtoul(value, NULL, 0) != 0;
+    }
+    else if (strcmp(key, "memtest") == 0) {
+        if (strcmp(value, "always") == 0)
+            cfg->memtest = BOOTCFG_MEMTEST_ALWAYS;
+        else if (strcmp(value, "cold") == 0)
+            cfg->memtest = BOOTCFG_MEMTEST_COLD;
+        else if (strcmp(value, "never") == 0)
+            cfg->memtest = BOOTCFG_MEMTEST_NEVER;
+        else
+            return ERROR;
+    }
+    else if (strcmp(key, "memtest_every") == 0) {
+        cfg->memtestEvery = strtoul(value, NULL, 0);
+    }
+    else {
+        return ERROR;
+    }
+    return OK;
+}
+
+/*
+ * bootCfgLoad()
+ *
+ * Fills cfg with the defaults, then whatever /BOOTCFG sets. Lines that
+ * don't parse are reported and skipped.
+ *
+ * RETURNS: OK, or ERROR if there's no /BOOTCFG (cfg holds the defaults)
+ */
+int bootCfgLoad(bootCfg_t *cfg)
+{
+    static char buf[BOOTCFG_MAX_SIZE + 1];
+    FIL fp;
+    UINT len;
+    char *line;
+    char *next;
+
+    cfg->fastboot     = FALSE;
+    cfg->memtest      = BOOTCFG_MEMTEST_ALWAYS;
+    cfg->memtestEvery = 0;
+
+    memset(&fp, 0, sizeof(fp));
+    if (f_open(&fp, "/bootcfg", FA_READ) != FR_OK &&
+        f_open(&fp, "/BOOTCFG", FA_READ) != FR_OK)
+        return ERROR;
+
+    if (f_read(&fp, buf, BOOTCFG_MAX_SIZE, &len) != FR_OK)
+        len = 0;
+    f_close(&fp);
+    buf[len] = '\0';
+
+    for (line = buf; line; line = next) {
+        char *value;
+
+        next = strchr(line, '\n');
+        if (next)
+            *next++ = '\0';
+        if ((value = strchr(line, '#')) != NULL)
+            *value = '\0';
+
+        line = trim(line);
+        if (*line == '\0')
+            continue;
+
+        value = strchr(line, '=');
+        if (!value) {
+            iprintf("bootcfg: ignoring %s\n\r", line);
+            continue;
+        }
+        *value++ = '\0';
+        line  = trim(line);
+        value = trim(value);
+        if (bootCfgSet(cfg, line, value) != OK)
+            iprintf("bootcfg: ignoring %s=%s\n\r", line, value);
+    }
+
+    return OK;
+}
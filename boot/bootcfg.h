@@ -0,0 +1,32 @@
+/*******************************************************************************
+ *
+ * bootcfg.h
+ *
+ * Boot options from /BOOTCFG on the SD card, see bootcfg.c
+ *
+ * Copyright (C) 2013 Paul Quevedo
+ *
+ * This program is free software.  It comes without any warranty, to the extent
+ * permitted by applicable law.  You can redistribute it and/or modify it under
+ * the terms of the WTF Public License (WTFPL), Version 2, as published by
+ * Sam Hocevar.  See http://sam.zoy.org/wtfpl/COPYING for more details.
+ *
+ *******************************************************************************/
+#ifndef __BOOTCFG_H__
+#define __BOOTCFG_H__
+#include "globalDefs.h"
+
+enum {
+    BOOTCFG_MEMTEST_ALWAYS,
+    BOOTCFG_MEMTEST_COLD,   /* Cold boots, and every memtestEvery warm boot */
+    BOOTCFG_MEMTEST_NEVER,
+};
+
+typedef struct {
+    bool32_t fastboot;      /* No countdown unless a key is already waiting */
+    uint32_t memtest;
+    uint32_t memtestEvery;  /* 0 for cold boots only */
+} bootCfg_t;
+
+extern int bootCfgLoad(bootCfg_t *cfg);
+#endif
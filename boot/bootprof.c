@@ -0,0 +1,110 @@
+/*******************************************************************************
+ *
+ * bootprof.c
+ *
+ * Boot stage timestamps. bootStage() closes the stage running and opens the
+ * next one, so main() only marks where each stage starts. The table lives
+ * in SRAM until bootHandoff(), DDR is wiped by the memory test on the way.
+ * bootHandoff() prints it and copies it to BOOTINFO for the app.
+ *
+ * The clock starts in clockInit(), as soon as main() has the L4 clocks up.
+ * The ROM and the few register writes before that aren't counted.
+ *
+ * Copyright (C) 2013 Paul Quevedo
+ *
+ * This program is free software.  It comes without any warranty, to the extent
+ * permitted by applicable law.  You can redistribute it and/or modify it under
+ * the terms of the WTF Public License (WTFPL), Version 2, as published by
+ * Sam Hocevar.  See http://sam.zoy.org/wtfpl/COPYING for more details.
+ *
+ *******************************************************************************/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "globalDefs.h"
+#include "am335x.h"
+#include "clock.h"
+#include "bootinfo.h"
+#include "bootprof.h"
+
+static bootInfo_t bootInfo;
+
+static void bootStageEnd(uint32_t nowUs)
+{
+    bootStage_t *stage;
+
+    if (bootInfo.numStages == 0)
+        return;
+    stage = &bootInfo.stages[bootInfo.numStages - 1];
+    stage->us = nowUs - stage->startUs;
+}
+
+/*
+ * bootStage()
+ *
+ * Ends the current stage and starts name. Past BOOTINFO_MAX_STAGES the last
+ * stage keeps running and soaks up the rest.
+ */
+void bootStage(const char *name)
+{
+    uint32_t nowUs = CLOCK_US(clockNow());
+    bootStage_t *stage;
+
+    if (bootInfo.numStages == BOOTINFO_MAX_STAGES)
+        return;
+
+    bootStageEnd(nowUs);
+    stage = &bootInfo.stages[bootInfo.numStages++];
+    strncpy(stage->name, name, BOOTINFO_NAME_LEN - 1);
+    stage->startUs = nowUs;
+    stage->us      = 0;
+}
+
+/*
+ * bootWarmCount()
+ *
+ * Counts warm boots in a row in BOOTINFO, reading the last boot's count
+ * back first. Call it once DDR is up and before anything writes there.
+ *
+ * RETURNS: the count including this boot, 0 on a cold boot or when the
+ *          last count didn't make it through the reset
+ */
+uint32_t bootWarmCount(uint32_t resetCause)
+{
+    uint32_t warmBoots = 0;
+
+    if (!(resetCause & PRM_RSTST_GLOBAL_COLD_RST) &&
+        BOOTINFO->warmCheck == ~BOOTINFO->warmBoots)
+        warmBoots = BOOTINFO->warmBoots + 1;
+
+    bootInfo.resetCause = resetCause;
+    bootInfo.warmBoots  = warmBoots;
+    bootInfo.warmCheck  = ~warmBoots;
+    return warmBoots;
+}
+
+/*
+ * bootHandoff()
+ *
+ * Ends the last stage, prints the table and publishes it at BOOTINFO.
+ * Call it last thing before jumping to the app.
+ */
+void bootHandoff(void)
+{
+    uint64_t now = clockNow();
+    int i;
+
+    bootStageEnd(CLOCK_US(now));
+    bootInfo.magic   = BOOTINFO_MAGIC;
+    bootInfo.handoff = (uint32_t)now;
+    bootInfo.totalUs = CLOCK_US(now);
+
+    iprintf("Boot stage       start us        us\n\r");
+    for (i = 0; i < bootInfo.numStages; i++)
+        iprintf("  %-12s %10u %9u\n\r", bootInfo.stages[i].name,
+                bootInfo.stages[i].startUs, bootInfo.stages[i].us);
+    iprintf("  %-12s %10s %9u\n\r", "total", "", bootInfo.totalUs);
+
+    memcpy(BOOTINFO, &bootInfo, sizeof(bootInfo));
+}
@@ -0,0 +1,22 @@
+/*******************************************************************************
+ *
+ * bootprof.h
+ *
+ * Boot stage timestamps, see bootprof.c
+ *
+ * Copyright (C) 2013 Paul Quevedo
+ *
+ * This program is free software.  It comes without any warranty, to the extent
+ * permitted by applicable law.  You can redistribute it and/or modify it under
+ * the terms of the WTF Public License (WTFPL), Version 2, as published by
+ * Sam Hocevar.  See http://sam.zoy.org/wtfpl/COPYING for more details.
+ *
+ *******************************************************************************/
+#ifndef __BOOTPROF_H__
+#define __BOOTPROF_H__
+#include <stdint.h>
+
+extern void     bootStage(const char *name);
+extern uint32_t bootWarmCount(uint32_t resetCause);
+extern void     bootHandoff(void);
+#endif
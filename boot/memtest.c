@@ -0,0 +1,172 @@
+/*******************************************************************************
+ *
+ * memtest.c
+ *
+ * DDR bring-up tests, in order:
+ *
+ *   data bus     walking ones and zeros through one word, every data line
+ *   address bus  a word at each power of 2 offset, any address line stuck
+ *                or shorted shows up as one of them aliasing another
+ *   pattern      each word written with its own address, then with its
+ *                inverse, and read back. MEMTEST_FULL covers the whole
+ *                range (fill all, then verify all), MEMTEST_QUICK one
+ *                block from each region until budgetUs runs out.
+ *
+ * The bootloader runs with the MMU off so DDR is strongly ordered and
+ * uncached. The pattern goes through NEON 16 byte loads and stores, which
+ * still reach the EMIF as bursts rather than one word at a time. Those
+ * loops live in memtestneon.c, the only object built with -mfpu=neon, so
+ * nothing here can pick up a VFP register before neonEnable() runs.
+ *
+ * Copyright (C) 2013 Paul Quevedo
+ *
+ * This program is free software.  It comes without any warranty, to the extent
+ * permitted by applicable law.  You can redistribute it and/or modify it under
+ * the terms of the WTF Public License (WTFPL), Version 2, as published by
+ * Sam Hocevar.  See http://sam.zoy.org/wtfpl/COPYING for more details.
+ *
+ *******************************************************************************/
+#include <stdio.h>
+#include <stdint.h>
+
+#include "globalDefs.h"
+#include "clock.h"
+#include "memtest.h"
+
+#define MEMTEST_REGIONS     64      /* Quick samples one block of each */
+
+static void neonEnable(bool32_t on)
+{
+    uint32_t reg;
+
+    asm volatile ("mrc p15, #0, %[out], c1, c0, #2" : [out] "=r" (reg));
+    reg |= 0x00f00000;                          /* CPACR cp10, cp11 */
+    asm volatile ("mcr p15, #0, %[in], c1, c0, #2" : : [in] "r" (reg));
+    asm volatile ("isb");
+    reg = on ? 0x40000000 : 0;                  /* FPEXC.EN */
+    asm volatile ("vmsr fpexc, %[in]" : : [in] "r" (reg));
+}
+
+static int memtestFail(memtestResult_t *result, const char *test,
+                       volatile uint32_t *addr, uint32_t expected)
+{
+    result->test     = test;
+    result->addr     = (uint32_t)addr;
+    result->expected = expected;
+    result->actual   = *addr;
+    return ERROR;
+}
+
+static int memtestDataBus(volatile uint32_t *addr, memtestResult_t *result)
+{
+    uint32_t bit;
+
+    for (bit = 1; bit != 0; bit <<= 1) {
+        *addr = bit;
+        if (*addr != bit)
+            return memtestFail(result, "data bus", addr, bit);
+        *addr = ~bit;
+        if (*addr != ~bit)
+            return memtestFail(result, "data bus", addr, ~bit);
+    }
+    return OK;
+}
+
+/* Barr, "Software-Based Memory Testing" */
+static int memtestAddrBus(volatile uint32_t *base, uint32_t size,
+                          memtestResult_t *result)
+{
+    const uint32_t pattern = 0xaaaaaaaa;
+    const uint32_t anti    = 0x55555555;
+    uint32_t mask = size / 4 - 1;
+    uint32_t offset;
+    uint32_t test;
+
+    for (offset = 1; offset & mask; offset <<= 1)
+        base[offset] = pattern;
+
+    /* Stuck high: writing word 0 lands on a power of 2 */
+    base[0] = anti;
+    for (offset = 1; offset & mask; offset <<= 1)
+        if (base[offset] != pattern)
+            return memtestFail(result, "address bus", &base[offset], pattern);
+    base[0] = pattern;
+
+    /* Stuck low or shorted: each power of 2 lands somewhere else */
+    for (test = 1; test & mask; test <<= 1) {
+        base[test] = anti;
+        if (base[0] != pattern)
+            return memtestFail(result, "address bus", &base[0], pattern);
+        for (offset = 1; offset & mask; offset <<= 1)
+            if (offset != test && base[offset] != pattern)
+                return memtestFail(result, "address bus", &base[offset],
+                                   pattern);
+        base[test] = pattern;
+    }
+    return OK;
+}
+
+static int memtestPattern(uint32_t *start, uint32_t bytes,
+                          memtestResult_t *result)
+{
+    static const uint32_t seeds[2] = { 0, 0xffffffff };
+    uint32_t *bad;
+    int i;
+
+    for (i = 0; i < 2; i++) {
+        memtestFill(start, bytes, seeds[i]);
+        bad = memtestVerify(start, bytes, seeds[i]);
+        if (bad != NULL)
+            return memtestFail(result, "pattern", bad,
+                               (uint32_t)bad ^ seeds[i]);
+    }
+
+    result->covered += bytes;
+    return OK;
+}
+
+/*
+ * memtest()
+ *
+ * Runs the tests cfg asks for over DDR. Destroys its contents.
+ *
+ * RETURNS: OK, or ERROR with the first failure in result
+ */
+int memtest(const memtestCfg_t *cfg, memtestResult_t *result)
+{
+    uint32_t *base = (uint32_t *)cfg->base;
+    uint64_t start = clockNow();
+    uint64_t budget = start + (uint64_t)cfg->budgetUs * CLOCK_TICKS_PER_US;
+    int status = OK;
+
+    result->test    = NULL;
+    result->covered = 0;
+
+    neonEnable(TRUE);
+
+    if (memtestDataBus(base, result) != OK ||
+        memtestAddrBus(base, cfg->size, result) != OK) {
+        status = ERROR;
+    }
+    else if (cfg->mode == MEMTEST_FULL) {
+        status = memtestPattern(base, cfg->size, result);
+    }
+    else {
+        uint32_t region = cfg->size / MEMTEST_REGIONS;
+        uint32_t i;
+
+        /* The last block of each region, to reach the top of DDR */
+        for (i = 1; i <= MEMTEST_REGIONS && status == OK; i++) {
+            uint32_t *block = base + (i * region - MEMTEST_BLOCK) / 4;
+
+            status = memtestPattern(block, MEMTEST_BLOCK, result);
+            if (clockNow() > budget)
+                break;
+        }
+    }
+
+    neonEnable(FALSE);
+
+    result->us = CLOCK_US(clockNow() - start);
+    return status;
+}
@@ -0,0 +1,47 @@
+/*******************************************************************************
+ *
+ * memtest.h
+ *
+ * DDR bring-up tests: data lines, address lines and a NEON pattern fill.
+ * See memtest.c.
+ *
+ * Copyright (C) 2013 Paul Quevedo
+ *
+ * This program is free software.  It comes without any warranty, to the extent
+ * permitted by applicable law.  You can redistribute it and/or modify it under
+ * the terms of the WTF Public License (WTFPL), Version 2, as published by
+ * Sam Hocevar.  See http://sam.zoy.org/wtfpl/COPYING for more details.
+ *
+ *******************************************************************************/
+#ifndef __MEMTEST_H__
+#define __MEMTEST_H__
+#include <stdint.h>
+
+enum {
+    MEMTEST_QUICK,      /* Bus tests and a sample of every region, ~ms */
+    MEMTEST_FULL,       /* Bus tests and every word, twice, ~seconds */
+};
+
+typedef struct {
+    uint32_t base;
+    uint32_t size;      /* Bytes, a power of 2 */
+    uint32_t mode;
+    uint32_t budgetUs;  /* MEMTEST_QUICK stops sampling after this long */
+} memtestCfg_t;
+
+typedef struct {
+    const char *test;   /* Which test failed */
+    uint32_t addr;
+    uint32_t expected;
+    uint32_t actual;
+    uint32_t covered;   /* Bytes pattern tested */
+    uint32_t us;
+} memtestResult_t;
+
+extern int memtest(const memtestCfg_t *cfg, memtestResult_t *result);
+
+/* memtestneon.c, only with the VFP on */
+#define MEMTEST_BLOCK       4096    /* Pattern unit, and the quick sample */
+extern void memtestFill(uint32_t *start, uint32_t bytes, uint32_t seed);
+extern uint32_t *memtestVerify(uint32_t *start, uint32_t bytes, uint32_t seed);
+#endif
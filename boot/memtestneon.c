@@ -0,0 +1,74 @@
+/*******************************************************************************
+ *
+ * memtestneon.c
+ *
+ * The memtest pattern loops, the only code built with -mfpu=neon. Callers
+ * must have the VFP enabled, see neonEnable() in memtest.c.
+ *
+ * Copyright (C) 2013 Paul Quevedo
+ *
+ * This program is free software.  It comes without any warranty, to the extent
+ * permitted by applicable law.  You can redistribute it and/or modify it under
+ * the terms of the WTF Public License (WTFPL), Version 2, as published by
+ * Sam Hocevar.  See http://sam.zoy.org/wtfpl/COPYING for more details.
+ *
+ *******************************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+#include <arm_neon.h>
+
+#include "memtest.h"
+
+/* Each word gets its address ^ seed, 64 bytes a loop */
+void memtestFill(uint32_t *start, uint32_t bytes, uint32_t seed)
+{
+    const uint32_t first[4] = { 0, 4, 8, 12 };
+    uint32x4_t addr = vaddq_u32(vld1q_u32(first), vdupq_n_u32((uint32_t)start));
+    uint32x4_t step = vdupq_n_u32(16);
+    uint32x4_t mix  = vdupq_n_u32(seed);
+    uint32_t *end = start + bytes / 4;
+    uint32_t *p;
+
+    for (p = start; p < end; p += 16) {
+        vst1q_u32(p,      veorq_u32(addr, mix)); addr = vaddq_u32(addr, step);
+        vst1q_u32(p + 4,  veorq_u32(addr, mix)); addr = vaddq_u32(addr, step);
+        vst1q_u32(p + 8,  veorq_u32(addr, mix)); addr = vaddq_u32(addr, step);
+        vst1q_u32(p + 12, veorq_u32(addr, mix)); addr = vaddq_u32(addr, step);
+    }
+}
+
+/* Differences are gathered a block at a time, only a bad block is gone
+ * over a word at a time to find the culprit, which is returned */
+uint32_t *memtestVerify(uint32_t *start, uint32_t bytes, uint32_t seed)
+{
+    const uint32_t first[4] = { 0, 4, 8, 12 };
+    uint32x4_t addr = vaddq_u32(vld1q_u32(first), vdupq_n_u32((uint32_t)start));
+    uint32x4_t step = vdupq_n_u32(16);
+    uint32x4_t mix  = vdupq_n_u32(seed);
+    uint32_t *end = start + bytes / 4;
+    uint32_t *block;
+    uint32_t *p;
+
+    for (block = start; block < end; block += MEMTEST_BLOCK / 4) {
+        uint32x4_t diff = vdupq_n_u32(0);
+        uint32_t any;
+
+        for (p = block; p < block + MEMTEST_BLOCK / 4; p += 8) {
+            diff = vorrq_u32(diff, veorq_u32(vld1q_u32(p),
+                                             veorq_u32(addr, mix)));
+            addr = vaddq_u32(addr, step);
+            diff = vorrq_u32(diff, veorq_u32(vld1q_u32(p + 4),
+                                             veorq_u32(addr, mix)));
+            addr = vaddq_u32(addr, step);
+        }
+
+        any = vgetq_lane_u32(diff, 0) | vgetq_lane_u32(diff, 1) |
+              vgetq_lane_u32(diff, 2) | vgetq_lane_u32(diff, 3);
+        if (any) {
+            for (p = block; p < block + MEMTEST_BLOCK / 4; p++)
+                if (*p != ((uint32_t)p ^ seed))
+                    return p;
+        }
+    }
+    return NULL;
+}
@@ -0,0 +1,459 @@
+/*****************************************************************************
+ * SMODEM Streaming File Transfer Module
+ *
+ * Receive only, sliding window replacement for the stop-and-wait XMODEM
+ * module. The sender keeps up to a full window of frames in flight and the
+ * receiver acknowledges once per window instead of once per packet, so the
+ * line turnaround is paid every window (8K by default) rather than every 1K.
+ *
+ * Every frame has the same layout, little endian:
+ *
+ *   SYNC(0x16) | TYPE | SEQ[2] | LEN[2] | PAYLOAD[LEN] | CRC32[4]
+ *
+ * The CRC32 (see crc.c) covers TYPE through the end of PAYLOAD.
+ *
+ * Sender -> receiver: DATA frames numbered from 0, then an EOF frame whose
+ *                     SEQ is the number of DATA frames sent.
+ * Receiver -> sender: READY(window) to start, ACK(n) meaning every frame
+ *                     below n was received and the next window may be sent,
+ *                     NAK(n) to selectively retransmit frame n, CAN to abort.
+ *
+ * Rate switch: READY may carry a 4 byte rate. A sender that can follow
+ * echoes READY back and both ends move to that rate, after which READY is
+ * repeated at the new rate. A sender that starts sending DATA instead keeps
+ * the current rate. The uart is put back to baseRate when the transfer ends.
+ *
+ * Frames that arrive out of order are kept, only the missing ones are NAK'd.
+ * The receiver buffers a whole window before handing it back to the caller
+ * which lets the UART be polled while the caller is busy writing the SD card
+ * without losing characters. See tools/smsend.c for the host side.
+ *
+ * Copyright (C) 2013 Paul Quevedo
+ *
+ * This program is free software.  It comes without any warranty, to the extent
+ * permitted by applicable law.  You can redistribute it and/or modify it under
+ * the terms of the WTF Public License (WTFPL), Version 2, as published by
+ * Sam Hocevar.  See http://sam.zoy.org/wtfpl/COPYING for more details.
+ *
+ ****************************************************************************/
+#include <string.h>
+
+#include "globalDefs.h"
+#include "hardware.h"
+#include "crc.h"
+#include "smodem.h"
+
+/* Idle reads between NAK/ACK/READY resends. Each idle read is one uartRead()
+ * byte timeout */
+#define SMODEM_IDLE_POLLS 64
+
+#define SLOT_MASK (SMODEM_MAX_WINDOW - 1)
+
+/* readFrame() results besides the frame type */
+#define RX_IDLE  0
+#define RX_BAD  -1
+
+typedef enum {
+    STATE_UNINITIALIZED,
+    STATE_WAITING,
+    STATE_READY,
+    STATE_RECEIVING,
+} smodemState_t;
+
+typedef struct {
+    uint16_t len;
+    uint8_t  valid;
+    uint8_t  nakSent;
+    uint8_t  data[SMODEM_MAX_PAYLOAD];
+} smodemSlot_t;
+
+typedef struct {
+    int32_t  uartFd;
+    smodemState_t state;
+    uint32_t numRetries;
+    uint32_t window;
+    uint32_t baseRate;
+    uint32_t xferRate;
+    bool32_t switched;
+    uint16_t base;          /* Next frame to hand to the caller */
+    uint16_t granted;       /* Sender may transmit [granted, granted+window) */
+    uint16_t eofSeq;
+    bool32_t eofSeen;
+    bool32_t delivering;
+    smodemStats_t stats;
+    smodemSlot_t slot[SMODEM_MAX_WINDOW];
+    uint8_t  discard[SMODEM_MAX_PAYLOAD];
+} smodem_t;
+
+static smodem_t smodem;
+
+static void sendFrame(uint8_t type, uint16_t seq, const uint8_t *payload,
+                                               uint32_t len)
+{
+    uint8_t frame[SMODEM_HDR_SIZE + SMODEM_CTRL_MAX + SMODEM_CRC_SIZE];
+    uint32_t crc;
+    int i;
+
+    frame[0] = SMODEM_SYNC;
+    frame[1] = type;
+    frame[2] = seq & 0xff;
+    frame[3] = seq >> 8;
+    frame[4] = len;
+    frame[5] = 0;
+    for (i = 0; i < len; i++)
+        frame[SMODEM_HDR_SIZE + i] = payload[i];
+
+    crc = crc32(0, &frame[1], SMODEM_HDR_SIZE - 1 + len);
+    frame[SMODEM_HDR_SIZE + len + 0] = crc;
+    frame[SMODEM_HDR_SIZE + len + 1] = crc >> 8;
+    frame[SMODEM_HDR_SIZE + len + 2] = crc >> 16;
+    frame[SMODEM_HDR_SIZE + len + 3] = crc >> 24;
+
+    uartWrite(smodem.uartFd, frame, SMODEM_HDR_SIZE + len + SMODEM_CRC_SIZE);
+}
+
+static void sendCtrl(uint8_t type, uint16_t seq)
+{
+    sendFrame(type, seq, NULL, 0);
+}
+
+static void sendReady(void)
+{
+    uint8_t rate[4];
+
+    rate[0] = smodem.xferRate;
+    rate[1] = smodem.xferRate >> 8;
+    rate[2] = smodem.xferRate >> 16;
+    rate[3] = smodem.xferRate >> 24;
+    sendFrame(SMODEM_READY, smodem.window, rate, sizeof(rate));
+}
+
+/* Back to the console rate once the last frame has left */
+static void restoreRate(void)
+{
+    if (smodem.switched) {
+        uartSetRate(smodem.uartFd, smodem.baseRate);
+        smodem.switched = FALSE;
+    }
+}
+
+static bool32_t inWindow(uint16_t seq)
+{
+    return (uint16_t)(seq - smodem.granted) < smodem.window;
+}
+
+/******************************************************************************
+ * readFrame
+ *
+ * Reads one frame from the uart. In window DATA payloads are received
+ * straight into their slot, everything else goes to the discard buffer.
+ *
+ * RETURNS: Frame type, RX_IDLE if nothing was received or RX_BAD
+ *****************************************************************************/
+static int32_t readFrame(uint16_t *seqOut)
+{
+    uint8_t hdr[SMODEM_HDR_SIZE];
+    uint8_t crcBuf[SMODEM_CRC_SIZE];
+    smodemSlot_t *slot = NULL;
+    uint8_t *payload;
+    uint16_t seq;
+    uint16_t len;
+    uint32_t crc;
+
+    if (uartRead(smodem.uartFd, hdr, 1) <= 0)
+        return RX_IDLE;
+
+    /* Hunt for sync, anything else is line noise */
+    if (hdr[0] != SMODEM_SYNC)
+        return RX_BAD;
+
+    if (uartRead(smodem.uartFd, &hdr[1], SMODEM_HDR_SIZE - 1)
+                                      != SMODEM_HDR_SIZE - 1)
+        return RX_BAD;
+
+    seq = hdr[2] | (hdr[3] << 8);
+    len = hdr[4] | (hdr[5] << 8);
+    if (len > SMODEM_MAX_PAYLOAD)
+        return RX_BAD;
+
+    if (hdr[1] == SMODEM_DATA && inWindow(seq)
+                              && !smodem.slot[seq & SLOT_MASK].valid) {
+        slot    = &smodem.slot[seq & SLOT_MASK];
+        payload = slot->data;
+    }
+    else {
+        payload = smodem.discard;
+    }
+
+    if (uartRead(smodem.uartFd, payload, len) != len)
+        return RX_BAD;
+    if (uartRead(smodem.uartFd, crcBuf, SMODEM_CRC_SIZE) != SMODEM_CRC_SIZE)
+        return RX_BAD;
+
+    crc = crc32(0, &hdr[1], SMODEM_HDR_SIZE - 1);
+    crc = crc32(crc, payload, len);
+    if (crc != (crcBuf[0]       | (crcBuf[1] << 8) |
+               (crcBuf[2] << 16) | ((uint32_t)crcBuf[3] << 24)))
+        return RX_BAD;
+
+    if (slot) {
+        slot->len     = len;
+        slot->valid   = TRUE;
+        slot->nakSent = FALSE;
+    }
+
+    *seqOut = seq;
+    return hdr[1];
+}
+
+/* NAK every missing frame in [base, end). With force set frames that were
+ * already NAK'd are asked for again */
+static void nakHoles(uint16_t end, bool32_t force)
+{
+    uint16_t seq;
+
+    for (seq = smodem.base; seq != end && inWindow(seq); seq++) {
+        smodemSlot_t *slot = &smodem.slot[seq & SLOT_MASK];
+        if (slot->valid || (slot->nakSent && !force))
+            continue;
+        sendCtrl(SMODEM_NAK, seq);
+        slot->nakSent = TRUE;
+        smodem.stats.naks++;
+    }
+}
+
+/* Highest frame held in the current window plus one */
+static uint16_t windowEnd(void)
+{
+    uint16_t end = smodem.base;
+    uint16_t seq;
+
+    for (seq = smodem.base; inWindow(seq); seq++) {
+        if (smodem.slot[seq & SLOT_MASK].valid)
+            end = seq + 1;
+    }
+    return end;
+}
+
+/* Everything the sender may send this window has arrived */
+static bool32_t batchComplete(void)
+{
+    uint16_t end = smodem.granted + smodem.window;
+    uint16_t seq;
+
+    if (smodem.eofSeen && (uint16_t)(smodem.eofSeq - smodem.granted)
+                                                    <= smodem.window)
+        end = smodem.eofSeq;
+
+    for (seq = smodem.base; seq != end; seq++) {
+        if (!smodem.slot[seq & SLOT_MASK].valid)
+            return FALSE;
+    }
+    return TRUE;
+}
+
+/******************************************************************************
+ * smodemInit
+ *
+ * Initializes SMODEM module. Requires pointer to initialized uart
+ *
+ * RETURNS: OK/ERROR
+ *****************************************************************************/
+int32_t smodemInit(smodemCfg_t *cfg)
+{
+    if (cfg->uartFd == -1)
+        return ERROR;
+
+    smodem.uartFd     = cfg->uartFd;
+    smodem.numRetries = cfg->numRetries;
+    smodem.window     = cfg->window;
+    smodem.baseRate   = cfg->baseRate;
+    smodem.xferRate   = cfg->xferRate;
+    smodem.switched   = FALSE;
+    if (smodem.window == 0 || smodem.window > SMODEM_MAX_WINDOW)
+        smodem.window = SMODEM_MAX_WINDOW;
+    memset(&smodem.stats, 0, sizeof(smodem.stats));
+    smodem.state = STATE_WAITING;
+
+    return OK;
+}
+
+/******************************************************************************
+ * smodemAbort
+ *
+ * Abort transmission if in process
+ *
+ * RETURNS: OK/ERROR
+ *****************************************************************************/
+int32_t smodemAbort(void)
+{
+    if (smodem.state == STATE_UNINITIALIZED)
+        return ERROR;
+
+    sendCtrl(SMODEM_CAN, smodem.base);
+    sendCtrl(SMODEM_CAN, smodem.base);
+    restoreRate();
+    smodem.state = STATE_WAITING;
+
+    return OK;
+}
+
+void smodemGetStats(smodemStats_t *stats)
+{
+    *stats = smodem.stats;
+}
+
+/******************************************************************************
+ * smodemRecv
+ *
+ * Returns the next frame of the transfer in order (up to 1024 bytes).
+ * Blocks while a window is being received.
+ *
+ * RETURNS: ERROR or numBytes of received. If 0 then transmission is complete
+ *****************************************************************************/
+int32_t smodemRecv(uint8_t *outBuffer, uint32_t numBytes)
+{
+    uint32_t idle = 0;
+    uint16_t seq;
+    int i;
+
+    switch (smodem.state) {
+    case STATE_UNINITIALIZED:
+        return ERROR;
+    case STATE_WAITING:
+        smodem.base       = 0;
+        smodem.granted    = 0;
+        smodem.eofSeen    = FALSE;
+        smodem.delivering = FALSE;
+        for (i = 0; i < SMODEM_MAX_WINDOW; i++) {
+            smodem.slot[i].valid   = FALSE;
+            smodem.slot[i].nakSent = FALSE;
+        }
+        sendReady();
+        smodem.state = STATE_READY;
+        break;
+    default:
+        break;
+    }
+
+    while (1) {
+        if (smodem.delivering) {
+            smodemSlot_t *slot = &smodem.slot[smodem.base & SLOT_MASK];
+
+            if (slot->valid) {
+                if (numBytes > slot->len)
+                    numBytes = slot->len;
+                memcpy(outBuffer, slot->data, numBytes);
+                slot->valid   = FALSE;
+                slot->nakSent = FALSE;
+                smodem.base++;
+                return numBytes;
+            }
+
+            /* Window consumed. Hand the sender a new one */
+            smodem.delivering = FALSE;
+            smodem.granted    = smodem.base;
+            if (smodem.eofSeen && smodem.base == smodem.eofSeq) {
+                sendCtrl(SMODEM_ACK, smodem.base);
+                sendCtrl(SMODEM_ACK, smodem.base);
+                restoreRate();
+                smodem.state = STATE_WAITING;
+                return 0;
+            }
+            sendCtrl(SMODEM_ACK, smodem.base);
+            idle = 0;
+        }
+
+        switch (readFrame(&seq)) {
+        case RX_IDLE:
+            if (++idle >= smodem.numRetries) {
+                if (smodem.state == STATE_RECEIVING)
+                    smodemAbort();
+                restoreRate();
+                smodem.state = STATE_WAITING;
+                return ERROR;
+            }
+            if (idle % SMODEM_IDLE_POLLS)
+                break;
+
+            if (smodem.state == STATE_READY) {
+                sendReady();
+            }
+            else if (smodem.slot[smodem.base & SLOT_MASK].valid) {
+                /* Sender went quiet mid window, likely a lost EOF or a short
+                 * final window. Pass on what we have, chase the rest */
+                nakHoles(windowEnd(), TRUE);
+                smodem.delivering = TRUE;
+            }
+            else if (windowEnd() != smodem.base) {
+                nakHoles(windowEnd(), TRUE);
+            }
+            else {
+                /* Nothing at all, our ACK may have been lost */
+                sendCtrl(SMODEM_ACK, smodem.base);
+            }
+            break;
+
+        case RX_BAD:
+            smodem.stats.crcErrors++;
+            break;
+
+        case SMODEM_DATA:
+            idle = 0;
+            smodem.state = STATE_RECEIVING;
+            smodem.stats.frames++;
+            if ((int16_t)(seq - smodem.base) < 0) {
+                /* Already delivered, sender missed an ACK */
+                smodem.stats.duplicates++;
+                sendCtrl(SMODEM_ACK, smodem.granted);
+                break;
+            }
+            if (!inWindow(seq))
+                break;
+            nakHoles(seq, FALSE);
+            if (batchComplete())
+                smodem.delivering = TRUE;
+            break;
+
+        case SMODEM_EOF:
+            idle = 0;
+            if (smodem.state == STATE_READY) {
+                /* Either an empty file or a retransmitted EOF from the
+                 * previous transfer. ACK both so the sender can finish */
+                sendCtrl(SMODEM_ACK, seq);
+                if (seq == 0) {
+                    smodem.state = STATE_WAITING;
+                    return 0;
+                }
+                break;
+            }
+            smodem.eofSeq  = seq;
+            smodem.eofSeen = TRUE;
+            nakHoles(seq, FALSE);
+            if (batchComplete())
+                smodem.delivering = TRUE;
+            break;
+
+        case SMODEM_READY:
+            /* Sender accepted the offered rate */
+            if (smodem.state == STATE_READY && smodem.xferRate
+                                           && !smodem.switched) {
+                if (uartSetRate(smodem.uartFd, smodem.xferRate) == OK)
+                    smodem.switched = TRUE;
+                else
+                    smodem.xferRate = 0;
+                sendReady();
+            }
+            idle = 0;
+            break;
+
+        case SMODEM_CAN:
+            restoreRate();
+            smodem.state = STATE_WAITING;
+            return ERROR;
+
+        default:
+            break;
+        }
+    }
+}
@@ -0,0 +1,57 @@
+/*******************************************************************************
+ *
+ * smodem.h
+ *
+ * Streaming (sliding window) file transfer protocol. See smodem.c for the
+ * wire format.
+ *
+ * Copyright (C) 2013 Paul Quevedo
+ *
+ * This program is free software.  It comes without any warranty, to the extent
+ * permitted by applicable law.  You can redistribute it and/or modify it under
+ * the terms of the WTF Public License (WTFPL), Version 2, as published by
+ * Sam Hocevar.  See http://sam.zoy.org/wtfpl/COPYING for more details.
+ *
+ *******************************************************************************/
+#ifndef __SMODEM_H__
+#define __SMODEM_H__
+#include "hardware.h"
+
+#define SMODEM_SYNC         0x16
+#define SMODEM_MAX_PAYLOAD  1024
+#define SMODEM_MAX_WINDOW   8
+#define SMODEM_HDR_SIZE     6   /* sync, type, seq[2], len[2] */
+#define SMODEM_CRC_SIZE     4
+#define SMODEM_CTRL_MAX     4   /* Largest control frame payload */
+
+/* Frame types. DATA/EOF flow sender -> receiver, the rest flow back */
+enum {
+    SMODEM_DATA  = 'D',
+    SMODEM_EOF   = 'E',
+    SMODEM_READY = 'R', /* seq holds the receiver window size, optional
+                         * 4 byte payload the rate to switch to */
+    SMODEM_ACK   = 'A', /* seq is the next frame expected, cumulative */
+    SMODEM_NAK   = 'N', /* seq is a single frame to retransmit */
+    SMODEM_CAN   = 'C',
+};
+
+typedef struct {
+    int32_t   uartFd;
+    int32_t   numRetries;   /* Idle reads tolerated before giving up */
+    uint32_t  window;       /* Frames in flight, 0 or > MAX uses MAX */
+    uint32_t  baseRate;     /* Rate the uart is at, restored when done */
+    uint32_t  xferRate;     /* Rate offered to the sender, 0 for none */
+} smodemCfg_t;
+
+typedef struct {
+    uint32_t  frames;
+    uint32_t  crcErrors;
+    uint32_t  naks;
+    uint32_t  duplicates;
+} smodemStats_t;
+
+extern int32_t smodemInit(smodemCfg_t *cfg);
+extern int32_t smodemAbort(void);
+extern int32_t smodemRecv(uint8_t *outBuffer, uint32_t numBytes);
+extern void    smodemGetStats(smodemStats_t *stats);
+#endif
@@ -0,0 +1,52 @@
+/*******************************************************************************
+ *
+ * bootinfo.h
+ *
+ * What the bootloader hands the app: how long each boot stage took. The
+ * bootloader fills it in from its own table (boot/bootprof.c) just before
+ * the jump, the block is reserved in the app's linkerscript.ld so nothing
+ * links over it and start.S leaves it alone.
+ *
+ * warmBoots is still read back by the next boot after the app cleared the
+ * magic, DDR usually keeps it across a warm reset.
+ *
+ * Times are DMTIMER2 (clock.c) microseconds. The app carries on counting
+ * from the bootloader's timer, so handoff is on the same time line as the
+ * app's clockNow() (low 32 bits, the app starts its own wrap count).
+ *
+ * Copyright (C) 2013 Paul Quevedo
+ *
+ * This program is free software.  It comes without any warranty, to the extent
+ * permitted by applicable law.  You can redistribute it and/or modify it under
+ * the terms of the WTF Public License (WTFPL), Version 2, as published by
+ * Sam Hocevar.  See http://sam.zoy.org/wtfpl/COPYING for more details.
+ *
+ *******************************************************************************/
+#ifndef __BOOTINFO_H__
+#define __BOOTINFO_H__
+#include <stdint.h>
+
+#define BOOTINFO_ADDR       0x80240000  /* linkerscript.ld BOOTINFO */
+#define BOOTINFO_MAGIC      0xb0071f00
+#define BOOTINFO_MAX_STAGES 12
+#define BOOTINFO_NAME_LEN   12
+
+typedef struct {
+    char     name[BOOTINFO_NAME_LEN];
+    uint32_t startUs;       /* Since the bootloader started the timer */
+    uint32_t us;
+} bootStage_t;
+
+typedef struct {
+    uint32_t    magic;
+    uint32_t    numStages;
+    uint32_t    handoff;    /* CLOCK_HZ ticks, low 32 bits, at the jump */
+    uint32_t    totalUs;    /* Timer start to the jump */
+    uint32_t    resetCause; /* PRM_RSTST */
+    uint32_t    warmBoots;  /* In a row, 0 on a cold boot */
+    uint32_t    warmCheck;  /* ~warmBoots, the count survived the reset */
+    bootStage_t stages[BOOTINFO_MAX_STAGES];
+} bootInfo_t;
+
+#define BOOTINFO ((bootInfo_t *)BOOTINFO_ADDR)
+#endif
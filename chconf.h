@@ -450,9 +450,18 @@
  * @brief   Threads descriptor structure extension.
  * @details User fields added to the end of the @p Thread structure.
  */
+#if !defined(__ASSEMBLER__)
+#include "thdstats.h"
+#include "vfp.h"
+#endif
+
 #if !defined(THREAD_EXT_FIELDS) || defined(__DOXYGEN__)
 #define THREAD_EXT_FIELDS                                                   \
-  /* Add threads custom fields here.*/
+  /* Add threads custom fields here.*/                                      \
+  struct logRing *p_logRing;    /* See log.c, NULL logs to the shared ring */ \
+  threadStats_t  p_stats;       /* See thdstats.c, running totals */        \
+  threadStats_t  p_statsLast;   /* p_stats at the last threadStatsDump() */ \
+  vfpContext_t  *p_vfp;         /* See vfp.c, NULL for no FPU */
 #endif
 
 /**
@@ -465,6 +474,9 @@
 #if !defined(THREAD_EXT_INIT_HOOK) || defined(__DOXYGEN__)
 #define THREAD_EXT_INIT_HOOK(tp) {                                          \
   /* Add threads initialization code here.*/                                \
+  (tp)->p_logRing = NULL;                                                   \
+  (tp)->p_vfp     = NULL;                                                   \
+  threadStatsClear(tp);                                                     \
 }
 #endif
 
@@ -479,6 +491,7 @@
 #if !defined(THREAD_EXT_EXIT_HOOK) || defined(__DOXYGEN__)
 #define THREAD_EXT_EXIT_HOOK(tp) {                                          \
   /* Add threads finalization code here.*/                                  \
+  vfpThreadExit(tp);                                                        \
 }
 #endif
 
@@ -488,7 +501,9 @@
  */
 #if !defined(THREAD_CONTEXT_SWITCH_HOOK) || defined(__DOXYGEN__)
 #define THREAD_CONTEXT_SWITCH_HOOK(ntp, otp) {                              \
-  /* System halt code here.*/                                               \
+  /* Context switch code here.*/                                            \
+  threadStatsSwitch(ntp, otp);                                              \
+  vfpSwitch(ntp);                                                           \
 }
 #endif
 
@@ -530,6 +545,21 @@
 /* Port-specific settings (override port settings defaulted in chcore.h).    */
 /*===========================================================================*/
 
+/**
+ * @brief   Idle thread sleeps in WFI, see wfi.h.
+ */
+#define ARM_ENABLE_WFI_IDLE             TRUE
+
+/**
+ * @brief   Tickless idle.
+ * @details While idle the system tick interrupt is held off until the next
+ *          virtual timer is due, see systickIdle() in hardware.c. FALSE
+ *          keeps the 1ms tick running through WFI.
+ */
+#if !defined(PORT_TICKLESS_IDLE) || defined(__DOXYGEN__)
+#define PORT_TICKLESS_IDLE              TRUE
+#endif
+
 #endif  /* _CHCONF_H_ */
 
 /** @} */
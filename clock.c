@@ -0,0 +1,145 @@
+/*******************************************************************************
+ *
+ * clock.c
+ *
+ * 64 bit monotonic clock. DMTIMER2 free runs off CLK_M_OSC, 24MHz or ~42ns a
+ * count, and the 32 bit counter is extended in software each time it's
+ * read. It wraps every ~179s, so something has to call clockNow() at least
+ * that often: the app's systick does, boot/ is never idle that long.
+ *
+ * The bootloader starts the timer and the app carries on counting from it,
+ * so clockNow() is time since the bootloader came up give or take the odd
+ * wrap it spent waiting on a transfer.
+ *
+ * Copyright (C) 2013 Paul Quevedo
+ *
+ * This program is free software.  It comes without any warranty, to the extent
+ * permitted by applicable law.  You can redistribute it and/or modify it under
+ * the terms of the WTF Public License (WTFPL), Version 2, as published by
+ * Sam Hocevar.  See http://sam.zoy.org/wtfpl/COPYING for more details.
+ *
+ *******************************************************************************/
+#include <stdint.h>
+#include "arm/asm.h"
+
+#if USE_CHIBIOS
+#include "ch.h"
+#endif
+
+#include "globalDefs.h"
+#include "am335x.h"
+#include "hardware.h"
+#include "clock.h"
+
+static uint32_t clockHigh;  /* TCRR wraps */
+static uint32_t clockLast;  /* TCRR at the last clockNow() */
+
+/*
+ * clockInit()
+ *
+ * Starts DMTIMER2 counting up from 0, or picks up the count if the
+ * bootloader already has it running
+ */
+void clockInit(void)
+{
+    if ((CM_PER_TIMER2_CLKCTRL & CM_MODULEMODE_MASK) == 0x2 &&
+        (CLOCK_TCLR & CLOCK_TCLR_ST)) {
+        clockLast = CLOCK_TCRR;
+        return;
+    }
+
+    CM_CLKSEL_TIMER2_CLK = CLOCK_CLKSEL_CLK_M_OSC;
+    CM_MODULEMODE_ENABLE (CM_PER_TIMER2_CLKCTRL);
+    CM_MODULE_IDLEST_FUNC(CM_PER_TIMER2_CLKCTRL);
+
+    /* Soft-reset */
+    CLOCK_TIOCP_CFG = CLOCK_TIOCP_SOFTRESET;
+    while (CLOCK_TIOCP_CFG & CLOCK_TIOCP_SOFTRESET)
+        ;
+    CLOCK_TIOCP_CFG = CLOCK_TIOCP_IDLEMODE(0x1);  /* Ignore idle req */
+
+    CLOCK_TSICR = CLOCK_TSICR_POSTED;
+
+    CLOCK_TLDR = 0;     /* Reload on overflow, a full 32 bits */
+    while (CLOCK_TWPS & CLOCK_TWPS_W_PEND_TLDR)
+        ;
+    CLOCK_TCRR = 0;
+    while (CLOCK_TWPS & CLOCK_TWPS_W_PEND_TCRR)
+        ;
+    CLOCK_TCLR = CLOCK_TCLR_AR | CLOCK_TCLR_ST; /* Start, auto-reload */
+    while (CLOCK_TWPS & CLOCK_TWPS_W_PEND_TCLR)
+        ;
+
+    clockHigh = 0;
+    clockLast = 0;
+}
+
+/*
+ * clockNow()
+ *
+ * RETURNS: CLOCK_HZ counts since clockInit()
+ */
+uint64_t clockNow(void)
+{
+    uint32_t flags;
+    uint32_t now;
+    uint64_t ticks;
+
+    _irq_save(flags);
+    now = CLOCK_TCRR;
+    if (now < clockLast)
+        clockHigh++;
+    clockLast = now;
+    ticks = ((uint64_t)clockHigh << 32) | now;
+    _irq_restore(flags);
+
+    return ticks;
+}
+
+static void clockWait(uint64_t end)
+{
+    while (clockNow() < end)
+        ;
+}
+
+/*
+ * clockDelayUs()
+ *
+ * Busy-waits us microseconds, regardless of clocks, caches or the MMU
+ */
+void clockDelayUs(uint32_t us)
+{
+    clockWait(clockNow() + (uint64_t)us * CLOCK_TICKS_PER_US);
+}
+
+/*
+ * clockSleepUs()
+ *
+ * Waits us microseconds, giving the CPU away for whole system ticks and
+ * spinning the rest. A plain clockDelayUs() without the kernel.
+ */
+void clockSleepUs(uint32_t us)
+{
+    uint64_t end = clockNow() + (uint64_t)us * CLOCK_TICKS_PER_US;
+#if USE_CHIBIOS
+    systime_t ticks = us / (1000000 / CH_FREQUENCY);
+
+    /* chThdSleep(n) returns anywhere in the nth tick, so one short */
+    if (ticks > 1)
+        chThdSleep(ticks - 1);
+#endif
+    clockWait(end);
+}
+
+/****************************
+ * Millisecond ticks
+ ****************************/
+uint32_t tickGet(void)
+{
+    return clockNow() / (CLOCK_HZ / 1000);
+}
+
+void tickDelay(uint32_t numTicks)
+{
+    clockSleepUs(numTicks * 1000);
+}
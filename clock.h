@@ -0,0 +1,29 @@
+/*******************************************************************************
+ *
+ * clock.h
+ *
+ * 64 bit monotonic clock on DMTIMER2, free running off the 24MHz crystal.
+ * Shared by boot/ and the app, see clock.c.
+ *
+ * Copyright (C) 2013 Paul Quevedo
+ *
+ * This program is free software.  It comes without any warranty, to the extent
+ * permitted by applicable law.  You can redistribute it and/or modify it under
+ * the terms of the WTF Public License (WTFPL), Version 2, as published by
+ * Sam Hocevar.  See http://sam.zoy.org/wtfpl/COPYING for more details.
+ *
+ *******************************************************************************/
+#ifndef __CLOCK_H__
+#define __CLOCK_H__
+#include <stdint.h>
+
+#define CLOCK_HZ            24000000    /* MASTER_OSC */
+#define CLOCK_TICKS_PER_US  (CLOCK_HZ / 1000000)
+
+#define CLOCK_US(ticks)     ((ticks) / CLOCK_TICKS_PER_US)
+
+extern void     clockInit(void);
+extern uint64_t clockNow(void);
+extern void     clockDelayUs(uint32_t us);
+extern void     clockSleepUs(uint32_t us);
+#endif
@@ -0,0 +1,18 @@
+/*******************************************************************************
+ *
+ * crc.h
+ *
+ * Copyright (C) 2013 Paul Quevedo
+ *
+ * This program is free software.  It comes without any warranty, to the extent
+ * permitted by applicable law.  You can redistribute it and/or modify it under
+ * the terms of the WTF Public License (WTFPL), Version 2, as published by
+ * Sam Hocevar.  See http://sam.zoy.org/wtfpl/COPYING for more details.
+ *
+ *******************************************************************************/
+#ifndef __CRC_H__
+#define __CRC_H__
+#include "globalDefs.h"
+
+extern uint32_t crc32(uint32_t crc, const uint8_t *dataPtr, uint32_t numBytes);
+#endif
@@ -0,0 +1,211 @@
+/******************************************************************************
+ *
+ * edma.c
+ *
+ * EDMA3 channel controller driver for the beaglebone/am335x processor.
+ * Channels are direct mapped to their events and owned by shadow region 0,
+ * completions are reported through region 0's interrupt.
+ *
+ * Copyright (C) 2013 Paul Quevedo
+ *
+ * This program is free software.  It comes without any warranty, to the extent
+ * permitted by applicable law.  You can redistribute it and/or modify it under
+ * the terms of the WTF Public License (WTFPL), Version 2, as published by
+ * Sam Hocevar.  See http://sam.zoy.org/wtfpl/COPYING for more details.
+ *
+ *****************************************************************************/
+#include "arm/asm.h"
+
+#include "globalDefs.h"
+#include "am335x.h"
+#include "hardware.h"
+
+/* PaRAM sets above the channel numbers are free for links */
+#define EDMA_FIRST_LINK_PARAM EDMA_NUM_CHANNELS
+
+extern uint8_t _dma_start[];    /* linkerscript.ld, mapped uncached */
+extern uint8_t _dma_end[];
+
+static bool32_t edmaInitialized;
+static uint32_t edmaNextParam = EDMA_FIRST_LINK_PARAM;
+
+static struct {
+    edmaCallback_t cb;
+    void *arg;
+} edmaChannels[EDMA_NUM_CHANNELS];
+
+/*
+ * edmaCompletionISR()
+ *
+ * Region 0 transfer completion. Transfer completion codes are set up to
+ * equal the channel number so IPR bits map straight back to channels.
+ */
+static void edmaCompletionISR(void)
+{
+    int bank;
+
+    for (bank = 0; bank < 2; bank++) {
+        uint32_t pending;
+
+        while ((pending = EDMA_S0_IPR(bank)) != 0) {
+            uint32_t bit  = 31 - __builtin_clz(pending);
+            uint32_t chan = bank * 32 + bit;
+
+            EDMA_S0_ICR(bank) = 1 << bit;
+            if (edmaChannels[chan].cb)
+                edmaChannels[chan].cb(chan, edmaChannels[chan].arg);
+        }
+    }
+
+    /* Anything that came in since needs a fresh interrupt */
+    EDMA_S0_IEVAL = 1;
+}
+
+int edmaInit(void)
+{
+    int i;
+
+    if (edmaInitialized)
+        return OK;
+
+    CM_MODULEMODE_ENABLE (CM_PER_TPCC_CLKCTRL);
+    CM_MODULE_IDLEST_FUNC(CM_PER_TPCC_CLKCTRL);
+    CM_MODULEMODE_ENABLE (CM_PER_TPTC0_CLKCTRL);
+    CM_MODULE_IDLEST_FUNC(CM_PER_TPTC0_CLKCTRL);
+    CM_MODULEMODE_ENABLE (CM_PER_TPTC1_CLKCTRL);
+    CM_MODULE_IDLEST_FUNC(CM_PER_TPTC1_CLKCTRL);
+    CM_MODULEMODE_ENABLE (CM_PER_TPTC2_CLKCTRL);
+    CM_MODULE_IDLEST_FUNC(CM_PER_TPTC2_CLKCTRL);
+
+    /* Everything on queue 0 / TC0 */
+    for (i = 0; i < EDMA_NUM_CHANNELS / 8; i++)
+        EDMA_DMAQNUM(i) = 0;
+
+    EDMA_EMCR(0)  = 0xFFFFFFFF;
+    EDMA_EMCR(1)  = 0xFFFFFFFF;
+    EDMA_CCERRCLR = 0xFFFFFFFF;
+
+    hwInstallIRQ(IRQ_EDMACOMPINT, edmaCompletionISR, INT_PRIORITY_HIGH);
+
+    edmaInitialized = TRUE;
+
+    return OK;
+}
+
+/*
+ * edmaChannelConfig()
+ *
+ * Hands chan to region 0, maps it to the PaRAM set of the same number and
+ * sets up cb to be called, from the ISR, when a transfer using TCC chan
+ * completes. The channel's event stays disabled until edmaEnable().
+ */
+int edmaChannelConfig(uint32_t chan, edmaCallback_t cb, void *arg)
+{
+    uint32_t bank = chan / 32;
+    uint32_t bit  = 1 << (chan & 0x1f);
+
+    if (!edmaInitialized || chan >= EDMA_NUM_CHANNELS)
+        return ERROR;
+
+    edmaChannels[chan].cb  = cb;
+    edmaChannels[chan].arg = arg;
+
+    EDMA_DCHMAP(chan)  = EDMA_DCHMAP_PAENTRY(chan);
+    EDMA_DRAE(0, bank) |= bit;
+
+    EDMA_S0_EECR(bank) = bit;
+    EDMA_S0_SECR(bank) = bit;
+    EDMA_S0_ICR(bank)  = bit;
+    EDMA_EMCR(bank)    = bit;
+
+    if (cb)
+        EDMA_S0_IESR(bank) = bit;
+    else
+        EDMA_S0_IECR(bank) = bit;
+
+    return OK;
+}
+
+/*
+ * edmaParamAlloc()
+ *
+ * Hands out PaRAM sets not tied to a channel, for use as link targets.
+ * There is no free, callers keep theirs for good.
+ *
+ * RETURNS: PaRAM set number, or ERROR once they run out
+ */
+int edmaParamAlloc(void)
+{
+    if (edmaNextParam >= EDMA_NUM_PARAMS)
+        return ERROR;
+
+    return edmaNextParam++;
+}
+
+void edmaParamSet(uint32_t param, const edmaParam_t *set)
+{
+    const uint32_t *words = (const uint32_t *)set;
+    int i;
+
+    for (i = 0; i < sizeof(edmaParam_t) / sizeof(uint32_t); i++)
+        EDMA_PARAM(param, i) = words[i];
+}
+
+void edmaEnable(uint32_t chan)
+{
+    EDMA_S0_EESR(chan / 32) = 1 << (chan & 0x1f);
+}
+
+/*
+ * edmaDisable()
+ *
+ * Stops chan responding to its event. Events that arrive meanwhile are
+ * still latched and run as soon as the channel is enabled again.
+ */
+void edmaDisable(uint32_t chan)
+{
+    EDMA_S0_EECR(chan / 32) = 1 << (chan & 0x1f);
+}
+
+/* An event is latched and waiting for chan to be enabled */
+bool32_t edmaPending(uint32_t chan)
+{
+    return (EDMA_S0_ER(chan / 32) & (1 << (chan & 0x1f))) != 0;
+}
+
+/* Manually triggered event, same as the peripheral raising it */
+void edmaTrigger(uint32_t chan)
+{
+    EDMA_S0_ESR(chan / 32) = 1 << (chan & 0x1f);
+}
+
+static bool32_t edmaUncached(const void *addr)
+{
+    return (const uint8_t *)addr >= _dma_start &&
+           (const uint8_t *)addr <  _dma_end;
+}
+
+/*
+ * edmaCacheClean()
+ *
+ * Writes back any dirty lines covering a buffer the EDMA is about to read.
+ * Nothing to do for DMA_BSS buffers.
+ */
+void edmaCacheClean(const void *addr, uint32_t len)
+{
+    if (!edmaUncached(addr))
+        _dcache_clean_range(addr, len);
+}
+
+/*
+ * edmaCacheInvalidate()
+ *
+ * Drops lines covering a buffer the EDMA has written so the CPU sees the
+ * new data. Partial lines at either end are cleaned first, so neighbours
+ * sharing them survive, but the CPU mustn't write them during the transfer.
+ */
+void edmaCacheInvalidate(const void *addr, uint32_t len)
+{
+    if (!edmaUncached(addr))
+        _dcache_invalidate_range(addr, len);
+}
@@ -2,11 +2,11 @@
 /* Low level disk I/O module for FatFs                                   */
 /*-----------------------------------------------------------------------*/
 #include <stdio.h>
-#include <stdlib.h>
 
 #include "globalDefs.h"
 #include "am335x.h"
 #include "sdhc.h"
+#include "pool.h"
 
 #include "diskio.h"		/* FatFs lower layer API */
 
@@ -24,6 +24,8 @@ static fatdev_t fatdev[MAX_DRIVES] = {
     [DRIVE_SDHC_0] = { .hwInst = SDHC_0 },
 };
 
+POOL_DECLARE(cardPool, "sdhc_card", sizeof(sdhcCard_t), MAX_DRIVES);
+
 /*-----------------------------------------------------------------------*/
 /* Inidialize a Drive                                                    */
 /*-----------------------------------------------------------------------*/
@@ -40,7 +42,7 @@ DSTATUS disk_initialize(BYTE drv)
             break;
 
         if (fatdev[drv].devCtx == 0)
-            fatdev[drv].devCtx  = calloc(1, sizeof(sdhcCard_t *));
+            fatdev[drv].devCtx  = poolCalloc(&cardPool);
 
         if (fatdev[drv].devCtx) {
             sdhcCard_t *card = fatdev[drv].devCtx;
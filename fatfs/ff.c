@@ -95,8 +95,10 @@
 /                   Changed option name _FS_SHARE to _FS_LOCK.
 /---------------------------------------------------------------------------*/
 
+#include <string.h>		/* memcpy() etc, arm/string.S on the target */
 #include "ff.h"			/* FatFs configurations and declarations */
 #include "diskio.h"		/* Declarations of low level disk I/O functions */
+#include "trace.h"		/* f_read()/f_write() spans */
 
 
 /*--------------------------------------------------------------------------
@@ -528,37 +530,19 @@ static WCHAR LfnBuf[_MAX_LFN+1];
 /* Copy memory to memory */
 static
 void mem_cpy (void* dst, const void* src, UINT cnt) {
-	BYTE *d = (BYTE*)dst;
-	const BYTE *s = (const BYTE*)src;
-
-#if _WORD_ACCESS == 1
-	while (cnt >= sizeof (int)) {
-		*(int*)d = *(int*)s;
-		d += sizeof (int); s += sizeof (int);
-		cnt -= sizeof (int);
-	}
-#endif
-	while (cnt--)
-		*d++ = *s++;
+	memcpy(dst, src, cnt);
 }
 
 /* Fill memory */
 static
 void mem_set (void* dst, int val, UINT cnt) {
-	BYTE *d = (BYTE*)dst;
-
-	while (cnt--)
-		*d++ = (BYTE)val;
+	memset(dst, val, cnt);
 }
 
 /* Compare memory to memory */
 static
 int mem_cmp (const void* dst, const void* src, UINT cnt) {
-	const BYTE *d = (const BYTE *)dst, *s = (const BYTE *)src;
-	int r = 0;
-
-	while (cnt-- && (r = *d++ - *s++) == 0) ;
-	return r;
+	return memcmp(dst, src, cnt);
 }
 
 /* Check if chr is contained in the string */
@@ -2409,6 +2393,17 @@ FRESULT f_open (
 
 
 
+#if TRACE_ENABLE
+/* f_read()/f_write() are defined under these names, the traced wrappers
+   follow f_write() */
+#define f_read	f_read_untraced
+#define f_write	f_write_untraced
+static FRESULT f_read_untraced (FIL*, void*, UINT, UINT*);
+#if !_FS_READONLY
+static FRESULT f_write_untraced (FIL*, const void*, UINT, UINT*);
+#endif
+#endif
+
 /*-----------------------------------------------------------------------*/
 /* Read File                                                             */
 /*-----------------------------------------------------------------------*/
@@ -2625,10 +2620,48 @@ FRESULT f_write (
 
 	LEAVE_FF(fp->fs, FR_OK);
 }
+#endif /* !_FS_READONLY */
+
+
+#if TRACE_ENABLE
+#undef f_read
+#undef f_write
+
+FRESULT f_read (
+	FIL *fp,
+	void *buff,
+	UINT btr,
+	UINT *br
+)
+{
+	FRESULT res;
+
+	TRACE_BEGIN(TRACE_ID_F_READ);
+	res = f_read_untraced(fp, buff, btr, br);
+	TRACE_END(TRACE_ID_F_READ);
+	return res;
+}
 
+#if !_FS_READONLY
+FRESULT f_write (
+	FIL *fp,
+	const void *buff,
+	UINT btw,
+	UINT *bw
+)
+{
+	FRESULT res;
 
+	TRACE_BEGIN(TRACE_ID_F_WRITE);
+	res = f_write_untraced(fp, buff, btw, bw);
+	TRACE_END(TRACE_ID_F_WRITE);
+	return res;
+}
+#endif
+#endif /* TRACE_ENABLE */
 
 
+#if !_FS_READONLY
 /*-----------------------------------------------------------------------*/
 /* Synchronize the File Object                                           */
 /*-----------------------------------------------------------------------*/
@@ -28,9 +28,16 @@ typedef unsigned short	WORD;
 typedef unsigned short	WCHAR;
 
 /* These types must be 32-bit integer */
+#if HOST_BUILD		/* long is 64 bits on the host (sim/) */
+#include <stdint.h>
+typedef int32_t			LONG;
+typedef uint32_t		ULONG;
+typedef uint32_t		DWORD;
+#else
 typedef long			LONG;
 typedef unsigned long	ULONG;
 typedef unsigned long	DWORD;
+#endif
 
 #endif
 
@@ -13,6 +13,11 @@
 #ifndef __GLOBALDEFS_H__
 #define __GLOBALDEFS_H__
 
+#if HOST_BUILD
+/* Host side tools (see tools/) build the protocol modules natively. long is
+ * 64 bits there so take the fixed width types from the C library instead */
+#include <stdint.h>
+#else
 typedef unsigned char  uint8_t;
 typedef unsigned short uint16_t;
 typedef unsigned long  uint32_t;
@@ -20,6 +25,7 @@ typedef unsigned long  uint32_t;
 typedef signed char    int8_t;
 typedef signed short   int16_t;
 typedef signed long    int32_t;
+#endif
 
 typedef unsigned char  bool8_t;
 typedef unsigned short bool16_t;
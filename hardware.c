@@ -22,11 +22,25 @@
 #include "globalDefs.h"
 #include "am335x.h"
 #include "hardware.h"
+#include "clock.h"
+#include "bootinfo.h"
+#include "log.h"
+#include "thdstats.h"
+#include "vfp.h"
 
 /****************************
  * Interrupt Controller
  ****************************/
 void __attribute__ ((section (".bss"))) (*isrVectorTable[NUM_IRQS])(void);
+uint8_t isrPriority[NUM_IRQS];  /* _irq_eh's threshold, as INTC_ILR */
+volatile uint32_t isrNesting;   /* Maintained by _irq_eh */
+
+/* _irq_eh loads both with one LDM, irq first */
+#define NO_FAST_IRQ 0xff            /* Never a SIR_IRQ number */
+struct {
+    uint32_t irq;
+    void (*handler)(void);
+} isrFast = { NO_FAST_IRQ, NULL };
 
 void hwClearIRQ(uint32_t irqNum)
 {
@@ -42,12 +56,45 @@ void hwInstallIRQ(uint32_t irqNum, void (*isrPtr)(void), int priority)
         return;
 
     INTC_MIR_SET(irqBank)   = irqBit; /* Disable IRQ */
+    if (irqNum == isrFast.irq)
+        isrFast.irq = NO_FAST_IRQ;
     INTC_ILR(irqNum) = INTC_ILR_PRIORITY(priority);
+    isrPriority[irqNum]     = priority;
     isrVectorTable[irqNum]  = isrPtr;
     INTC_ISR_CLEAR(irqBank) = irqBit;
     INTC_MIR_CLEAR(irqBank) = irqBit; /* Enable IRQ */
 }
 
+/*
+ * hwInstallFastIRQ()
+ *
+ * Gives irqNum the INTC's top priority and the fast path in _irq_eh. The
+ * am335x's FIQ line only reaches the core on HS devices, so this is the
+ * nearest a GP part gets: a handful of instructions from the exception
+ * vector to isrPtr, nothing stacked but what C needs.
+ *
+ * RETURNS: OK, or ERROR if another source already has it
+ */
+int hwInstallFastIRQ(uint32_t irqNum, void (*isrPtr)(void))
+{
+    uint32_t irqBank = irqNum / 32;
+    uint32_t irqBit  = 1 << (irqNum & 0x1f);
+
+    if (irqNum >= NUM_IRQS || isrPtr == NULL ||
+        (isrFast.irq != NO_FAST_IRQ && isrFast.irq != irqNum))
+        return ERROR;
+
+    INTC_MIR_SET(irqBank)   = irqBit;
+    INTC_ILR(irqNum) = INTC_ILR_PRIORITY(INT_PRIORITY_FAST);
+    isrPriority[irqNum] = INT_PRIORITY_FAST;
+    isrFast.handler = isrPtr;
+    isrFast.irq     = irqNum;
+    INTC_ISR_CLEAR(irqBank) = irqBit;
+    INTC_MIR_CLEAR(irqBank) = irqBit;
+
+    return OK;
+}
+
 /****************************
  * System Tick
  ****************************/
@@ -55,6 +102,7 @@ static void systickISR(void)
 {
     SYSTICK_TISR |= SYSTICK_TISR_OVF_IT_FLAG;
     hwClearIRQ(IRQ_TINT1_1MS);
+    clockNow();     /* At least once a wrap, ~179s */
 
     chSysLockFromIsr();
     chSysTimerHandlerI();
@@ -103,37 +151,129 @@ static void systickInit(void)
     SYSTICK_TCLR = SYSTICK_TCLR_AR | SYSTICK_TCLR_ST; /* Start, auto-reload */
 }
 
+#define SYSTICK_IDLE_MAX_TICKS  1000    /* Wake once a second regardless */
+#define SYSTICK_LAST_COUNT      0xFFFFFFFF
+
+static void systickSetWrap(uint32_t overflows)
+{
+    SYSTICK_TOWR = overflows;
+    while (SYSTICK_TWPS & SYSTICK_TWPS_W_PEND_TOWR)
+        ;
+    SYSTICK_TOCR = 0;
+    while (SYSTICK_TWPS & SYSTICK_TWPS_W_PEND_TOCR)
+        ;
+}
+
+/*
+ * systickIdle()
+ *
+ * The idle thread's port_wait_for_interrupt() (wfi.h). With
+ * PORT_TICKLESS_IDLE the tick interrupt is held off until the next virtual
+ * timer is due by having the 1ms timer swallow that many overflows (TOWR)
+ * before raising one. The counter keeps running its 1ms periods so no time
+ * is lost, whichever interrupt ends the WFI the overflows it swallowed are
+ * handed to the kernel before anything else runs.
+ */
+void systickIdle(void)
+{
+#if PORT_TICKLESS_IDLE
+    systime_t ticks = SYSTICK_IDLE_MAX_TICKS;
+    systime_t missed;
+
+    chSysLock();
+
+    if (vtlist.vt_next != (VirtualTimer *)&vtlist)
+        ticks = vtlist.vt_next->vt_time;
+    LIMIT_HI_VAL(ticks, SYSTICK_IDLE_MAX_TICKS);
+
+    if (ticks <= 1 || chSchIsRescRequiredI()) {
+        chSysUnlock();
+        asm volatile ("wfi" : : : "memory");
+        return;
+    }
+
+    /* Keep clear of an overflow while TOWR/TOCR are rewritten, a count is
+     * ~30us which covers the posted writes */
+    while (SYSTICK_TCRR == SYSTICK_LAST_COUNT)
+        ;
+    systickSetWrap(ticks - 1);
+
+    /* Wakes on any pending IRQ, the I bit only stops it being taken */
+    _dsb();
+    asm volatile ("wfi" : : : "memory");
+
+    while (SYSTICK_TCRR == SYSTICK_LAST_COUNT)
+        ;
+    if (SYSTICK_TISR & SYSTICK_TISR_OVF_IT_FLAG)
+        missed = ticks - 1;     /* Deadline, systickISR() does the last */
+    else
+        missed = SYSTICK_TOCR;
+    systickSetWrap(0);
+
+    /* What chSysTimerHandlerI() would have done, without firing anything
+     * as missed is short of the first timer's deadline */
+    vtlist.vt_systime += missed;
+    if (vtlist.vt_next != (VirtualTimer *)&vtlist)
+        vtlist.vt_next->vt_time -= missed;
+#if CH_DBG_THREADS_PROFILING
+    currp->p_time += missed;
+#endif
+
+    chSysUnlock();
+#else
+    asm volatile ("wfi" : : : "memory");
+#endif
+}
+
 /****************************
  * MMU
  ****************************/
+/* make DDR_CACHE=WT for the old write-through mapping, to compare against */
+#if DDR_CACHE_WT
+#define DDR_ATTRIBUTES (MMU_ATTR_INNER_WT_NOWA | MMU_ATTR_OUTER_WB_WA)
+#else
+#define DDR_ATTRIBUTES (MMU_ATTR_INNER_WB_WA | MMU_ATTR_OUTER_WB_WA)
+#endif
+
+extern uint8_t _dma_start[];    /* linkerscript.ld */
+extern uint8_t _dma_end[];
+
 static void memInit(void)
 {
     mmuRegion_t ddr = {
         .physAddr    = 0x80000000,
         .virtAddr    = 0x80000000,
-        .pages       = 512, /* MBs */
-        .attributes  = MMU_ATTR_INNER_WT_NOWA
-                     | MMU_ATTR_OUTER_WB_WA,
+        .pages       = 512, /* MBs, 32 supersections */
+        .attributes  = DDR_ATTRIBUTES,
+        .permissions = MMU_PERM_SYS_RW_USR_RW,
+    };
+    mmuRegion_t dma = {
+        .physAddr    = (uint32_t)_dma_start,
+        .virtAddr    = (uint32_t)_dma_start,
+        .pages       = (_dma_end - _dma_start) / 0x10000,
+        .pageSize    = MMU_PAGE_64KB,
+        .attributes  = MMU_ATTR_NONCACHEABLE    /* EDMA buffers, DMA_BSS */
+                     | MMU_ATTR_EXECUTE_NEVER,
         .permissions = MMU_PERM_SYS_RW_USR_RW,
     };
     mmuRegion_t ocmc = {
         .physAddr    = 0x40300000,
         .virtAddr    = 0x40300000,
         .pages       = 1, /* MBs */
-        .attributes  = MMU_ATTR_INNER_WT_NOWA
-                     | MMU_ATTR_OUTER_WB_WA,
+        .attributes  = DDR_ATTRIBUTES,
         .permissions = MMU_PERM_SYS_RW_USR_RW,
     };
     mmuRegion_t mmio = {
         .physAddr    = 0x44000000,
         .virtAddr    = 0x44000000,
-        .pages       = 960, /* 0x440000 to 0x80000000 */
+        .pages       = 960, /* 0x44000000 to 0x80000000, 60 supersections */
         .attributes  = MMU_ATTR_DEVICE_SHARED   /* via L3/L4 interconnect bus */
                      | MMU_ATTR_EXECUTE_NEVER,
         .permissions = MMU_PERM_SYS_RW_USR_RW,
     };
 
     _mmu_add_region(&ddr);
+    _mmu_add_region(&dma);  /* Over the top of ddr */
     _mmu_add_region(&ocmc);
     _mmu_add_region(&mmio);
 
@@ -151,116 +291,99 @@ static void memInit(void)
 /****************************
  * Performance Monitor
  ****************************/
-enum {
-    PERF_CNTR_DCACHE_MISS = 0,
-    PERF_CNTR_DCACHE_USED,
+const char *const perfMonNames[PERF_MON_MAX_COUNTERS] = {
+    [PERF_CNTR_DCACHE_MISS] = "l1d_miss",
+    [PERF_CNTR_DCACHE_USED] = "l1d",
+    [PERF_CNTR_L2_MISS]     = "l2_miss",
+#if !PROFILE
+    [PERF_CNTR_INST]        = "inst",
+#endif
 };
+
 static void perfMonInit(void)
 {
     _perfmon_add(PERF_CNTR_DCACHE_MISS, PERF_MON_L1D_CACHE_REFILL);
     _perfmon_add(PERF_CNTR_DCACHE_USED, PERF_MON_L1D_CACHE);
+    _perfmon_add(PERF_CNTR_L2_MISS,     PERF_MON_A8_L2_CACHE_MISS);
+#if !PROFILE
+    _perfmon_add(PERF_CNTR_INST,        PERF_MON_INST_RETIRED);
+#endif
+
+    /* Overflows extend the counters to 64 bits and drive the profiler */
+    hwInstallIRQ(IRQ_BENCH, (void (*)(void))_perfmon_overflow_isr,
+                 INT_PRIORITY_HIGH);
 
     _perfmon_enable();
 }
-static void perfMonUpdate(void)
+
+/*
+ * bootInfoLog()
+ *
+ * Logs the bootloader's stage times and how long the jump to here took.
+ * The magic is cleared after, a restart from the debugger that skips the
+ * bootloader then says so instead of repeating the last boot.
+ */
+static void bootInfoLog(void)
 {
-    /* TODO: something useful with this */
-    volatile uint32_t dcacheMiss = _perfmon_get(PERF_CNTR_DCACHE_MISS);
-    volatile uint32_t dcacheUsed = _perfmon_get(PERF_CNTR_DCACHE_USED);
+    bootInfo_t *info = BOOTINFO;
+    uint32_t i;
 
-    if (dcacheUsed == 0xffffffff) {
-        _perfmon_reset(PERF_CNTR_DCACHE_MISS);
-        _perfmon_reset(PERF_CNTR_DCACHE_USED);
+    if (info->magic != BOOTINFO_MAGIC) {
+        LOG("boot: no stage times from the bootloader\n\r");
+        return;
     }
-}
 
+    for (i = 0; i < info->numStages && i < BOOTINFO_MAX_STAGES; i++)
+        LOG("boot: %s at %u us, %u us\n\r", info->stages[i].name,
+            info->stages[i].startUs, info->stages[i].us);
+    LOG("boot: %u us to the jump, app up %u us after\n\r", info->totalUs,
+        CLOCK_US((uint32_t)clockNow() - info->handoff));
+    LOG("boot: reset cause %03x, %u warm boots in a row\n\r",
+        info->resetCause, info->warmBoots);
 
-/*
- * Blinker threads
- */
-static WORKING_AREA(waThread1, 128);
-static msg_t Thread1(void *p)
-{
-  chRegSetThreadName("blinker1");
-  while (TRUE) {
-    chThdSleepMilliseconds(500);
-    gpioToggle(HW_LED1_PORT, HW_LED1_PIN);
-  }
-  return 0;
-}
-static WORKING_AREA(waThread2, 128);
-static msg_t Thread2(void *p)
-{
-  chRegSetThreadName("blinker2");
-  while (TRUE) {
-    chThdSleepMilliseconds(1000);
-    gpioToggle(HW_LED2_PORT, HW_LED2_PIN);
-    perfMonUpdate();
-  }
-  return 0;
-}
-static WORKING_AREA(waThread3, 128);
-static msg_t Thread3(void *p)
-{
-  chRegSetThreadName("blinker3");
-  while (TRUE) {
-    chThdSleepMilliseconds(2000);
-    gpioToggle(HW_LED3_PORT, HW_LED3_PIN);
-  }
-  return 0;
+    info->magic = 0;
 }
 
-
-int main(void)
+/*
+ * hwInit()
+ *
+ * Brings up the interrupt controller, PMU, MMU/caches, systick and the
+ * kernel, then the console and logging. Returns as the ChibiOS main
+ * thread with IRQs enabled. Shared by the app and bench/.
+ */
+void hwInit(void)
 {
     extern uint32_t _exception_table_addr;  /* from linkerscript */
     uartCfg_t uartCfg = {
         .baud = BAUD_115200,
+        .mode = UART_MODE_IRQ,
         .fifo = { .enable = TRUE,
-                  .rxTrig = 1,
-                  .txTrig = 1, },
+                  .rxTrig = 16,   /* RX timeout irq picks up the rest */
+                  .txTrig = 32, },
     };
 
-    gpioConfig(HW_LED0_PORT, HW_LED0_PIN, GPIO_CFG_OUTPUT);
-    gpioConfig(HW_LED1_PORT, HW_LED1_PIN, GPIO_CFG_OUTPUT);
-    gpioConfig(HW_LED2_PORT, HW_LED2_PIN, GPIO_CFG_OUTPUT);
-    gpioConfig(HW_LED3_PORT, HW_LED3_PIN, GPIO_CFG_OUTPUT);
-
-    gpioSet(HW_LED0_PORT, HW_LED0_PIN);
-    gpioSet(HW_LED1_PORT, HW_LED1_PIN);
-    gpioSet(HW_LED2_PORT, HW_LED2_PIN);
-    gpioSet(HW_LED3_PORT, HW_LED3_PIN);
-
     _irq_disable();
     _irq_set_addr(&_exception_table_addr);
 
     /* Reset interrupt controller */
     memset(isrVectorTable, 0, sizeof(isrVectorTable));
+    memset(isrPriority, INT_PRIORITY_MIN, sizeof(isrPriority));
     INTC_SYSCONFIG = INTC_SYSCONFIG_RESET;
     while (!(INTC_SYSSTATUS & INTC_SYSSTATUS_RESETDONE))
         ;
     INTC_IDLE      = INTC_IDLE_FUNCIDLE; /* Free running clock */
     INTC_THRESHOLD = 0xff;               /* Enable irq generation */
 
-    uartConfig(UART_CONSOLE, &uartCfg);
     perfMonInit();
+    vfpInit();
     memInit();
+    clockInit();
     systickInit();
     chSysInit();                         /* Enables IRQ's */
+    uartConfig(UART_CONSOLE, &uartCfg);  /* IRQ mode needs the kernel */
+    logInit();
+    threadStatsInit(perfMonNames);
 
-    chThdCreateStatic(waThread1, sizeof(waThread1), NORMALPRIO, Thread1, NULL);
-    chThdCreateStatic(waThread2, sizeof(waThread2), NORMALPRIO, Thread2, NULL);
-    chThdCreateStatic(waThread3, sizeof(waThread3), NORMALPRIO, Thread3, NULL);
-
-    gpioClear(HW_LED0_PORT, HW_LED0_PIN);
-    gpioClear(HW_LED1_PORT, HW_LED1_PIN);
-    gpioClear(HW_LED2_PORT, HW_LED2_PIN);
-    gpioClear(HW_LED3_PORT, HW_LED3_PIN);
-
-    while (1) {
-        gpioToggle(HW_LED0_PORT, HW_LED0_PIN);
-        chThdSleepMilliseconds(250);
-    }
-
-    return 0;
+    LOG("ChibiOS/RT " CH_KERNEL_VERSION " up\n\r");
+    bootInfoLog();
 }
@@ -95,8 +95,8 @@
 #define UART_CONSOLE UART_0
 
 /**********************
- * System Tick
- * Temporary until RTOS
+ * Millisecond Ticks
+ * On the clock (clock.c), kernel or not
  *********************/
 extern uint32_t tickGet(void);
 extern void tickDelay(uint32_t numTicks);
@@ -104,7 +104,11 @@ extern void tickDelay(uint32_t numTicks);
 /**********************
  * Interrupts
  *********************/
+/* Lower is more urgent. An ISR can be preempted by any higher priority,
+ * never by its own or lower (see _irq_eh). Each one in use costs every
+ * thread stack an ISR's worth, PORT_ISR_LEVELS in chcore.h counts them */
 enum {
+    INT_PRIORITY_FAST    = 0,   /* hwInstallFastIRQ() only */
     INT_PRIORITY_MAX     = 1,
     INT_PRIORITY_HIGH    = 0x0F,
     INT_PRIORITY_DEFAULT = 0x1F,
@@ -115,6 +119,82 @@ enum {
 extern void hwClearIRQ  (uint32_t irqNum);
 extern void hwInstallIRQ(uint32_t irqNum, void (*isrPtr)(void), int priority);
 
+/* One source can take the fast path through _irq_eh, ahead of every other
+ * IRQ and with nothing else done for it. Its handler must not touch the
+ * kernel or anything that locks against ISRs, and is held off only by
+ * IRQs masked on the CPU. hwInstallIRQ() on the same line demotes it. */
+extern int  hwInstallFastIRQ(uint32_t irqNum, void (*isrPtr)(void));
+
+/* ISRs may instead be declared void isr(uint32_t *frame, uint32_t lr) and
+ * cast, _irq_eh passes the interrupted context (see start.S) */
+#define HW_IRQ_FRAME_PC(frame) ((frame)[5] - 4)
+
+/* ISRs run in MODE_SYS like threads, this tells them apart */
+extern volatile uint32_t isrNesting;
+#define hwInIsr() (isrNesting != 0)
+
+/**********************
+ * Performance Monitor
+ *********************/
+/* Event counters as hwInit() sets them up */
+enum {
+    PERF_CNTR_DCACHE_MISS = 0,
+    PERF_CNTR_DCACHE_USED,
+    PERF_CNTR_L2_MISS,
+    PERF_CNTR_INST,         /* PERF_MON_SAMPLE_COUNTER, the profiler's */
+};
+extern const char *const perfMonNames[];   /* NULL when not counting */
+
+extern void hwInit(void);
+
+/**********************
+ * EDMA
+ *********************/
+#define EDMA_NUM_CHANNELS 64
+#define EDMA_NUM_PARAMS   256
+#define EDMA_NULL_LINK    0xFFFF
+#define EDMA_MAX_COUNT    0xFFFF
+
+/* One PaRAM set, laid out as the hardware has it */
+typedef struct {
+    uint32_t opt;
+    uint32_t src;
+    uint16_t aCnt;
+    uint16_t bCnt;
+    uint32_t dst;
+    int16_t  srcBIdx;
+    int16_t  dstBIdx;
+    uint16_t link;      /* Byte offset of the set to reload, or NULL_LINK */
+    uint16_t bCntReload;
+    int16_t  srcCIdx;
+    int16_t  dstCIdx;
+    uint16_t cCnt;
+    uint16_t rsvd;
+} edmaParam_t;
+
+#define EDMA_LINK(param) (0x4000 + 0x20 * (param))
+
+/* Places a buffer in the uncached DDR window (linkerscript.ld .dma_bss),
+ * the EDMA and CPU see the same data without edmaCacheClean/Invalidate */
+#if HOST_BUILD
+#define DMA_BSS
+#else
+#define DMA_BSS __attribute__ ((section (".dma_bss"), aligned (64)))
+#endif
+
+typedef void (*edmaCallback_t)(uint32_t chan, void *arg);
+
+extern int  edmaInit         (void);
+extern int  edmaChannelConfig(uint32_t chan, edmaCallback_t cb, void *arg);
+extern int  edmaParamAlloc   (void);
+extern void edmaParamSet     (uint32_t param, const edmaParam_t *set);
+extern void edmaEnable       (uint32_t chan);
+extern void edmaDisable      (uint32_t chan);
+extern void edmaTrigger      (uint32_t chan);
+extern bool32_t edmaPending  (uint32_t chan);
+extern void edmaCacheClean     (const void *addr, uint32_t len);
+extern void edmaCacheInvalidate(const void *addr, uint32_t len);
+
 /**********************
  * GPIO
  *********************/
@@ -163,10 +243,37 @@ enum {
     BAUD_57600,
     BAUD_115200,
     BAUD_230400,
+    BAUD_460800,
+    BAUD_921600,
+    BAUD_1843200,
+    BAUD_3000000,
+    BAUD_3686400,
+
+    MAX_BAUDS,
+};
+
+/* Divisor settings for a rate, see uartBaudCalc() */
+typedef struct {
+    uint32_t mode;      /* UART_MDR1_MODE_16X or UART_MDR1_MODE_13X */
+    uint32_t divisor;
+    uint32_t actual;    /* Rate the divisor really gives, bps */
+    int32_t  errorPpm;  /* (actual - requested) in parts per million */
+} uartBaud_t;
+
+/* Worst rate error accepted by uartConfig()/uartSetRate() */
+#define UART_BAUD_MAX_ERROR_PPM 20000
+
+/* uartCfg_t.mode. IRQ and DMA modes need ChibiOS (USE_CHIBIOS) and a running
+ * kernel, uartWrite()/uartRead() may then block the calling thread */
+enum {
+    UART_MODE_POLLED,
+    UART_MODE_IRQ,
+    UART_MODE_DMA,  /* UART_0-2 only, forces both FIFO triggers to 1 */
 };
 
 typedef struct {
     uint32_t baud;
+    uint32_t mode;
     struct {
         bool32_t enable;
         uint32_t rxTrig;
@@ -175,6 +282,10 @@ typedef struct {
 } uartCfg_t;
 
 extern int  uartConfig(uint32_t inst, uartCfg_t *cfg);
+extern int  uartBaudCalc(uint32_t rate, uartBaud_t *baud);
+extern uint32_t uartBaudRate(uint32_t baud);
+extern int  uartSetRate(uint32_t inst, uint32_t rate);
+extern void uartDrain (uint32_t inst);
 extern int  uartWrite (uint32_t inst, uint8_t *data, uint32_t len);
 extern int  uartRead  (uint32_t inst, uint8_t *data, uint32_t len);
 extern void uartFlush (uint32_t inst, bool32_t txFifo);
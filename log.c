@@ -0,0 +1,196 @@
+/*******************************************************************************
+ *
+ * log.c
+ *
+ * Deferred logging. The hot path only copies a 32 byte record into a ring:
+ * a thread that registered its own ring is the only producer on it so no
+ * locking at all, everything else (ISRs, unregistered threads) shares one
+ * ring with IRQs masked for the copy. A full ring drops the record and
+ * counts it, the caller never waits on the uart. A low priority thread
+ * formats the records and reports any drops.
+ *
+ * Copyright (C) 2013 Paul Quevedo
+ *
+ * This program is free software.  It comes without any warranty, to the extent
+ * permitted by applicable law.  You can redistribute it and/or modify it under
+ * the terms of the WTF Public License (WTFPL), Version 2, as published by
+ * Sam Hocevar.  See http://sam.zoy.org/wtfpl/COPYING for more details.
+ *
+ *******************************************************************************/
+#include <stdio.h>
+#include <stdint.h>
+#include "arm/asm.h"
+#include "arm/perfmon.h"
+
+#include "ch.h"
+
+#include "globalDefs.h"
+#include "hardware.h"
+#include "log.h"
+
+#define LOG_SHARED_RECORDS 128  /* Power of 2 */
+#define LOG_MAX_RINGS      8
+#define LOG_DRAIN_MS       10   /* Drain thread poll when all rings empty */
+#define LOG_LINE_SIZE      128
+
+static logRecord_t sharedRecords[LOG_SHARED_RECORDS];
+static logRing_t sharedRing = {
+    .mask    = LOG_SHARED_RECORDS - 1,
+    .name    = "shared",
+    .records = sharedRecords,
+};
+
+static logRing_t *logRings[LOG_MAX_RINGS] = { &sharedRing };
+static volatile uint32_t numRings = 1;
+
+static inline __attribute__ ((always_inline))
+void ringPut(logRing_t *ring, const char *fmt, uint32_t a0, uint32_t a1,
+             uint32_t a2, uint32_t a3, uint32_t a4, uint32_t a5)
+{
+    uint32_t head = ring->head;
+    logRecord_t *rec;
+
+    if ((head - ring->tail) > ring->mask) {
+        ring->dropped++;
+        return;
+    }
+
+    rec = &ring->records[head & ring->mask];
+    rec->timestamp = _perfmon_ccnt();
+    rec->fmt       = fmt;
+    rec->args[0]   = a0;
+    rec->args[1]   = a1;
+    rec->args[2]   = a2;
+    rec->args[3]   = a3;
+    rec->args[4]   = a4;
+    rec->args[5]   = a5;
+
+    _dmb(); /* Record complete before the drain thread can see it */
+    ring->head = head + 1;
+}
+
+/*
+ * logPut()
+ *
+ * Use LOG(), which pads the argument list
+ */
+void logPut(const char *fmt, uint32_t a0, uint32_t a1, uint32_t a2,
+            uint32_t a3, uint32_t a4, uint32_t a5)
+{
+    Thread *tp = currp;
+    uint32_t flags;
+
+    if (!hwInIsr() && tp != NULL && tp->p_logRing != NULL) {
+        ringPut(tp->p_logRing, fmt, a0, a1, a2, a3, a4, a5);
+        return;
+    }
+
+    _irq_save(flags);
+    ringPut(&sharedRing, fmt, a0, a1, a2, a3, a4, a5);
+    _irq_restore(flags);
+}
+
+/*
+ * logRegister()
+ *
+ * Gives the calling thread a ring of its own. numRecords must be a power
+ * of 2 and the storage has to outlive the thread.
+ *
+ * RETURNS: OK, or ERROR on a bad size or when all ring slots are taken
+ */
+int logRegister(logRing_t *ring, const char *name,
+                logRecord_t *records, uint32_t numRecords)
+{
+    if (numRecords == 0 || (numRecords & (numRecords - 1)))
+        return ERROR;
+
+    ring->head     = 0;
+    ring->tail     = 0;
+    ring->dropped  = 0;
+    ring->reported = 0;
+    ring->mask     = numRecords - 1;
+    ring->name     = name;
+    ring->records  = records;
+
+    chSysLock();
+    if (numRings >= LOG_MAX_RINGS) {
+        chSysUnlock();
+        return ERROR;
+    }
+    logRings[numRings] = ring;
+    numRings++;
+    chSysUnlock();
+
+    currp->p_logRing = ring;
+
+    return OK;
+}
+
+static void logOutput(char *line, int len)
+{
+    LIMIT_HI_VAL(len, LOG_LINE_SIZE - 1);
+    uartWrite(UART_CONSOLE, (uint8_t *)line, len);
+}
+
+static uint32_t logDrainRing(logRing_t *ring)
+{
+    char line[LOG_LINE_SIZE];
+    uint32_t count = 0;
+    uint32_t dropped;
+    int len;
+
+    while (ring->tail != ring->head) {
+        logRecord_t *rec = &ring->records[ring->tail & ring->mask];
+
+        _dmb(); /* Pairs with the one in ringPut() */
+        len  = sniprintf(line, sizeof(line), "[%10lu] ", rec->timestamp);
+        len += sniprintf(line + len, sizeof(line) - len, rec->fmt,
+                         rec->args[0], rec->args[1], rec->args[2],
+                         rec->args[3], rec->args[4], rec->args[5]);
+        _dmb(); /* Done with the record before handing the slot back */
+        ring->tail++;
+
+        logOutput(line, len);
+        count++;
+    }
+
+    dropped = ring->dropped;
+    if (dropped != ring->reported) {
+        len = sniprintf(line, sizeof(line), "log: %lu dropped from %s\n\r",
+                        dropped - ring->reported, ring->name);
+        ring->reported = dropped;
+        logOutput(line, len);
+    }
+
+    return count;
+}
+
+static WORKING_AREA(waLogDrain, 1024);
+static msg_t logDrainThread(void *arg)
+{
+    chRegSetThreadName("log");
+
+    while (TRUE) {
+        uint32_t count = 0;
+        int i;
+
+        for (i = 0; i < numRings; i++)
+            count += logDrainRing(logRings[i]);
+
+        if (count == 0)
+            chThdSleepMilliseconds(LOG_DRAIN_MS);
+    }
+    return 0;
+}
+
+/*
+ * logInit()
+ *
+ * Starts the drain thread. LOG() works before this, records just queue up
+ * (or drop) until it runs.
+ */
+void logInit(void)
+{
+    chThdCreateStatic(waLogDrain, sizeof(waLogDrain), LOWPRIO + 1,
+                      logDrainThread, NULL);
+}
@@ -0,0 +1,65 @@
+/*******************************************************************************
+ *
+ * log.h
+ *
+ * Deferred logging. LOG() copies a timestamp, the format pointer and up to
+ * LOG_MAX_ARGS 32 bit arguments into a ring and returns, a low priority
+ * thread does the formatting and uart output later. See log.c.
+ *
+ * Formats are kept by pointer, so they and any %s arguments must live for
+ * good (string literals). 64 bit and floating point arguments don't fit.
+ *
+ * Copyright (C) 2013 Paul Quevedo
+ *
+ * This program is free software.  It comes without any warranty, to the extent
+ * permitted by applicable law.  You can redistribute it and/or modify it under
+ * the terms of the WTF Public License (WTFPL), Version 2, as published by
+ * Sam Hocevar.  See http://sam.zoy.org/wtfpl/COPYING for more details.
+ *
+ *******************************************************************************/
+#ifndef __LOG_H__
+#define __LOG_H__
+#include "globalDefs.h"
+
+#define LOG_MAX_ARGS 6
+
+typedef struct {
+    uint32_t    timestamp;  /* Cycle counter */
+    const char *fmt;
+    uint32_t    args[LOG_MAX_ARGS];
+} logRecord_t;
+
+typedef struct logRing {
+    volatile uint32_t head;     /* Producer only */
+    volatile uint32_t tail;     /* Drain thread only */
+    volatile uint32_t dropped;  /* Producer only, records lost to a full ring */
+    uint32_t     reported;      /* Drain thread only, drops already reported */
+    uint32_t     mask;
+    const char  *name;
+    logRecord_t *records;
+} logRing_t;
+
+#if USE_CHIBIOS
+/* Pads the argument list out to LOG_MAX_ARGS with zeros */
+#define LOG(...) LOG_ARGS(__VA_ARGS__, 0, 0, 0, 0, 0, 0, 0)
+#define LOG_ARGS(fmt, a0, a1, a2, a3, a4, a5, ...)                          \
+    logPut(fmt, (uint32_t)(a0), (uint32_t)(a1), (uint32_t)(a2),             \
+                (uint32_t)(a3), (uint32_t)(a4), (uint32_t)(a5))
+
+extern void logInit(void);
+extern int  logRegister(logRing_t *ring, const char *name,
+                        logRecord_t *records, uint32_t numRecords);
+extern void logPut(const char *fmt, uint32_t a0, uint32_t a1, uint32_t a2,
+                   uint32_t a3, uint32_t a4, uint32_t a5);
+#else
+/* No kernel to drain with (boot), print straight away */
+#include <stdio.h>
+#define LOG(...) iprintf(__VA_ARGS__)
+#endif
+
+#if DEBUG
+#define LOG_DEBUG(...) LOG(__VA_ARGS__)
+#else
+#define LOG_DEBUG(...)
+#endif
+#endif
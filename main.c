@@ -0,0 +1,147 @@
+/*******************************************************************************
+ *
+ * main.c
+ *
+ * The application: blinker threads plus the PMU, profiler and trace demos.
+ * Board bring up is in hardware.c.
+ *
+ * Copyright (C) 2013 Paul Quevedo
+ *
+ * This program is free software.  It comes without any warranty, to the extent
+ * permitted by applicable law.  You can redistribute it and/or modify it under
+ * the terms of the WTF Public License (WTFPL), Version 2, as published by
+ * Sam Hocevar.  See http://sam.zoy.org/wtfpl/COPYING for more details.
+ *
+ *******************************************************************************/
+#include <stdio.h>
+#include <stdint.h>
+#include "arm/perfmon.h"
+
+#include "ch.h"
+
+#include "globalDefs.h"
+#include "hardware.h"
+#include "log.h"
+#include "profiler.h"
+#include "thdstats.h"
+#include "pool.h"
+#include "trace.h"
+
+/* PROFILE=1 builds sample at 1kHz and dump after PROFILE_SECONDS */
+#define PROFILE_PERIOD  (MPU_CLKOUT / 1000)
+#define PROFILE_SECONDS 10
+
+/* TRACE=1 builds dump the trace buffer once after TRACE_SECONDS */
+#define TRACE_SECONDS   4
+
+static perfmonSnapshot_t perfMonLast;
+
+static void perfMonUpdate(void)
+{
+    perfmonSnapshot_t now;
+    perfmonSnapshot_t delta;
+
+    _perfmon_snapshot(&now);
+    _perfmon_delta(&perfMonLast, &now, &delta);
+    perfMonLast = now;
+
+    /* One second's worth fits 32 bits comfortably */
+    LOG("perf: %lu cycles, L1D %lu/%lu miss, L2 %lu miss\n\r",
+        (uint32_t)delta.cycles,
+        (uint32_t)delta.events[PERF_CNTR_DCACHE_MISS],
+        (uint32_t)delta.events[PERF_CNTR_DCACHE_USED],
+        (uint32_t)delta.events[PERF_CNTR_L2_MISS]);
+}
+
+
+/*
+ * Blinker threads
+ */
+static WORKING_AREA(waThread1, 128);
+static msg_t Thread1(void *p)
+{
+  chRegSetThreadName("blinker1");
+  while (TRUE) {
+    chThdSleepMilliseconds(500);
+    gpioToggle(HW_LED1_PORT, HW_LED1_PIN);
+  }
+  return 0;
+}
+static WORKING_AREA(waThread2, 1024); /* perfMonUpdate(), iprintf */
+static msg_t Thread2(void *p)
+{
+  int n = 0;
+
+  chRegSetThreadName("blinker2");
+  while (TRUE) {
+    chThdSleepMilliseconds(1000);
+    gpioToggle(HW_LED2_PORT, HW_LED2_PIN);
+    perfMonUpdate();
+    if (++n % 10 == 0)
+        threadStatsDump();
+    if (n % 60 == 0)
+        poolStatsDump();
+  }
+  return 0;
+}
+static WORKING_AREA(waThread3, 512);
+static msg_t Thread3(void *p)
+{
+#if PROFILE || TRACE_ENABLE
+  int n = 0;
+#endif
+
+  chRegSetThreadName("blinker3");
+  while (TRUE) {
+    chThdSleepMilliseconds(2000);
+    gpioToggle(HW_LED3_PORT, HW_LED3_PIN);
+#if PROFILE || TRACE_ENABLE
+    n++;
+#endif
+#if PROFILE
+    if (n == PROFILE_SECONDS / 2)
+        profDump();
+#endif
+#if TRACE_ENABLE
+    if (n == TRACE_SECONDS / 2)
+        traceDump();
+#endif
+  }
+  return 0;
+}
+
+
+int main(void)
+{
+    gpioConfig(HW_LED0_PORT, HW_LED0_PIN, GPIO_CFG_OUTPUT);
+    gpioConfig(HW_LED1_PORT, HW_LED1_PIN, GPIO_CFG_OUTPUT);
+    gpioConfig(HW_LED2_PORT, HW_LED2_PIN, GPIO_CFG_OUTPUT);
+    gpioConfig(HW_LED3_PORT, HW_LED3_PIN, GPIO_CFG_OUTPUT);
+
+    gpioSet(HW_LED0_PORT, HW_LED0_PIN);
+    gpioSet(HW_LED1_PORT, HW_LED1_PIN);
+    gpioSet(HW_LED2_PORT, HW_LED2_PIN);
+    gpioSet(HW_LED3_PORT, HW_LED3_PIN);
+
+    hwInit();
+    _perfmon_snapshot(&perfMonLast);
+#if PROFILE
+    profStart(PERF_MON_CPU_CYCLES, PROFILE_PERIOD);
+#endif
+
+    chThdCreateStatic(waThread1, sizeof(waThread1), NORMALPRIO, Thread1, NULL);
+    chThdCreateStatic(waThread2, sizeof(waThread2), NORMALPRIO, Thread2, NULL);
+    chThdCreateStatic(waThread3, sizeof(waThread3), NORMALPRIO, Thread3, NULL);
+
+    gpioClear(HW_LED0_PORT, HW_LED0_PIN);
+    gpioClear(HW_LED1_PORT, HW_LED1_PIN);
+    gpioClear(HW_LED2_PORT, HW_LED2_PIN);
+    gpioClear(HW_LED3_PORT, HW_LED3_PIN);
+
+    while (1) {
+        gpioToggle(HW_LED0_PORT, HW_LED0_PIN);
+        chThdSleepMilliseconds(250);
+    }
+
+    return 0;
+}
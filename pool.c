@@ -0,0 +1,165 @@
+/*******************************************************************************
+ *
+ * pool.c
+ *
+ * Fixed block pools and bump arenas. Both are O(1) and never fragment:
+ *
+ *   pool   blocks of one size. Freed blocks go on a free list, blocks never
+ *          handed out are taken off the end of the storage, so a pool
+ *          needs no setup before its first poolAlloc().
+ *   arena  a bump pointer, only ever reset as a whole. For things that
+ *          live as long as whatever owns the arena.
+ *
+ * Each keeps in-use/peak/failure counts, poolStatsDump() prints every pool
+ * and arena that has been touched. Callers are serialised by masking IRQs,
+ * so both are safe from threads and ISRs alike.
+ *
+ * Copyright (C) 2013 Paul Quevedo
+ *
+ * This program is free software.  It comes without any warranty, to the extent
+ * permitted by applicable law.  You can redistribute it and/or modify it under
+ * the terms of the WTF Public License (WTFPL), Version 2, as published by
+ * Sam Hocevar.  See http://sam.zoy.org/wtfpl/COPYING for more details.
+ *
+ *******************************************************************************/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "arm/asm.h"
+
+#include "globalDefs.h"
+#include "pool.h"
+
+#if HOST_BUILD
+#define POOL_LOCK(flags)    { (void)(flags); }
+#define POOL_UNLOCK(flags)  { }
+#else
+#define POOL_LOCK(flags)    _irq_save(flags)
+#define POOL_UNLOCK(flags)  _irq_restore(flags)
+#endif
+
+static pool_t  *poolList;
+static arena_t *arenaList;
+
+/****************************
+ * Pools
+ ****************************/
+void *poolAlloc(pool_t *pool)
+{
+    uint32_t flags = 0;
+    void *block = NULL;
+
+    POOL_LOCK(flags);
+    if (!pool->listed) {
+        pool->listed = TRUE;
+        pool->next   = poolList;
+        poolList     = pool;
+    }
+
+    if (pool->freeList != NULL) {
+        block = pool->freeList;
+        pool->freeList = *(void **)block;
+    }
+    else if (pool->fresh < pool->numBlocks) {
+        block = pool->base + pool->fresh++ * pool->blockSize;
+    }
+
+    if (block != NULL) {
+        if (++pool->inUse > pool->peak)
+            pool->peak = pool->inUse;
+    }
+    else {
+        pool->fails++;
+    }
+    POOL_UNLOCK(flags);
+
+    return block;
+}
+
+void *poolCalloc(pool_t *pool)
+{
+    void *block = poolAlloc(pool);
+
+    if (block != NULL)
+        memset(block, 0, pool->blockSize);
+    return block;
+}
+
+void poolFree(pool_t *pool, void *block)
+{
+    uint32_t flags = 0;
+
+    if (block == NULL)
+        return;
+
+    POOL_LOCK(flags);
+    *(void **)block = pool->freeList;
+    pool->freeList  = block;
+    pool->inUse--;
+    POOL_UNLOCK(flags);
+}
+
+/****************************
+ * Arenas
+ ****************************/
+/*
+ * arenaAlloc()
+ *
+ * RETURNS: size bytes, POOL_ALIGN aligned, or NULL when the arena is full
+ */
+void *arenaAlloc(arena_t *arena, uint32_t size)
+{
+    uint32_t flags = 0;
+    void *mem = NULL;
+
+    size = POOL_ROUND(size);
+
+    POOL_LOCK(flags);
+    if (!arena->listed) {
+        arena->listed = TRUE;
+        arena->next   = arenaList;
+        arenaList     = arena;
+    }
+
+    if (size <= arena->size - arena->used) {
+        mem = arena->base + arena->used;
+        arena->used += size;
+        if (arena->used > arena->peak)
+            arena->peak = arena->used;
+    }
+    else {
+        arena->fails++;
+    }
+    POOL_UNLOCK(flags);
+
+    return mem;
+}
+
+/* Everything allocated from the arena is gone */
+void arenaReset(arena_t *arena)
+{
+    arena->used = 0;
+}
+
+/*
+ * poolStatsDump()
+ *
+ * One line per pool and arena used so far, sizes in bytes
+ */
+void poolStatsDump(void)
+{
+    const pool_t *pool;
+    const arena_t *arena;
+
+    iprintf("POOL  %-10s %6s %6s %6s %5s %5s\n\r",
+            "name", "size", "total", "in_use", "peak", "fails");
+    for (pool = poolList; pool != NULL; pool = pool->next)
+        iprintf("      %-10s %6u %6u %6u %5u %5u\n\r", pool->name,
+                (unsigned)pool->blockSize, (unsigned)pool->numBlocks,
+                (unsigned)pool->inUse, (unsigned)pool->peak,
+                (unsigned)pool->fails);
+    for (arena = arenaList; arena != NULL; arena = arena->next)
+        iprintf("ARENA %-10s %6u %6s %6u %5u %5u\n\r", arena->name,
+                (unsigned)arena->size, "-", (unsigned)arena->used,
+                (unsigned)arena->peak, (unsigned)arena->fails);
+}
@@ -0,0 +1,66 @@
+/*******************************************************************************
+ *
+ * pool.h
+ *
+ * Fixed block pools and bump arenas over static storage, for the drivers
+ * in place of malloc. No kernel needed, boot/ and sim/ use them too.
+ *
+ * Copyright (C) 2013 Paul Quevedo
+ *
+ * This program is free software.  It comes without any warranty, to the extent
+ * permitted by applicable law.  You can redistribute it and/or modify it under
+ * the terms of the WTF Public License (WTFPL), Version 2, as published by
+ * Sam Hocevar.  See http://sam.zoy.org/wtfpl/COPYING for more details.
+ *
+ *******************************************************************************/
+#ifndef __POOL_H__
+#define __POOL_H__
+#include <stdint.h>
+
+#define POOL_ALIGN          8
+#define POOL_ROUND(size)    (((size) + POOL_ALIGN - 1) & ~(POOL_ALIGN - 1))
+
+typedef struct pool {
+    const char  *name;
+    uint32_t     blockSize;
+    uint32_t     numBlocks;
+    uint8_t     *base;
+    void        *freeList;  /* Blocks given back */
+    uint32_t     fresh;     /* Blocks never handed out start here */
+    uint32_t     inUse;
+    uint32_t     peak;
+    uint32_t     fails;
+    uint32_t     listed;    /* On the list for poolStatsDump() */
+    struct pool *next;
+} pool_t;
+
+typedef struct arena {
+    const char   *name;
+    uint32_t      size;
+    uint8_t      *base;
+    uint32_t      used;
+    uint32_t      peak;
+    uint32_t      fails;
+    uint32_t      listed;
+    struct arena *next;
+} arena_t;
+
+/* File scope, e.g. POOL_DECLARE(cardPool, "card", sizeof(card_t), 2); */
+#define POOL_DECLARE(var, name, size, count)                                \
+    static uint64_t var##Mem[(count) * POOL_ROUND(size) / sizeof(uint64_t)];\
+    static pool_t var = { name, POOL_ROUND(size), (count),                  \
+                          (uint8_t *)var##Mem, }
+
+#define ARENA_DECLARE(var, name, size)                                      \
+    static uint64_t var##Mem[POOL_ROUND(size) / sizeof(uint64_t)];          \
+    static arena_t var = { name, POOL_ROUND(size), (uint8_t *)var##Mem, }
+
+extern void *poolAlloc(pool_t *pool);
+extern void *poolCalloc(pool_t *pool);
+extern void  poolFree (pool_t *pool, void *block);
+
+extern void *arenaAlloc(arena_t *arena, uint32_t size);
+extern void  arenaReset(arena_t *arena);
+
+extern void  poolStatsDump(void);
+#endif
@@ -0,0 +1,109 @@
+/*******************************************************************************
+ *
+ * profiler.c
+ *
+ * Statistical profiler. PERF_MON_SAMPLE_COUNTER is set to overflow every
+ * period occurrences of an event (PERF_MON_CPU_CYCLES for a time profile,
+ * PERF_MON_L1D_CACHE_REFILL for a cache miss profile, ...) and each overflow
+ * records the interrupted pc, lr and thread in a ring holding the latest
+ * PROF_MAX_SAMPLES samples.
+ *
+ * profDump() prints them as
+ *      PROF BEGIN <event> <period> <samples> <lost>
+ *      PROF <pc> <lr> <thread>
+ *      PROF END
+ * which tools/profsym.py turns into flat, caller or folded (flamegraph)
+ * profiles against app.axf.
+ *
+ * Copyright (C) 2013 Paul Quevedo
+ *
+ * This program is free software.  It comes without any warranty, to the extent
+ * permitted by applicable law.  You can redistribute it and/or modify it under
+ * the terms of the WTF Public License (WTFPL), Version 2, as published by
+ * Sam Hocevar.  See http://sam.zoy.org/wtfpl/COPYING for more details.
+ *
+ *******************************************************************************/
+#include <stdio.h>
+#include <stdint.h>
+#include "arm/perfmon.h"
+
+#include "ch.h"
+
+#include "globalDefs.h"
+#include "hardware.h"
+#include "profiler.h"
+
+static profSample_t profSamples[PROF_MAX_SAMPLES];
+static volatile uint32_t profCount;     /* Samples taken since profStart() */
+static uint32_t profEvent;
+static uint32_t profPeriod;
+
+static void profSampleHook(uint32_t *frame, uint32_t lr)
+{
+    profSample_t *sample = &profSamples[profCount & (PROF_MAX_SAMPLES - 1)];
+    Thread *tp = currp;
+
+    sample->pc     = HW_IRQ_FRAME_PC(frame);
+    sample->lr     = lr;
+    sample->thread = (tp != NULL) ? tp->p_name : NULL;
+    profCount++;
+}
+
+/*
+ * profStart()
+ *
+ * Starts sampling every period events, dropping any earlier samples.
+ * Periods much below ~10000 cycles spend more time in the ISR than in the
+ * code being profiled.
+ *
+ * RETURNS: OK, or ERROR if the sampling counter isn't available
+ */
+int profStart(uint32_t event, uint32_t period)
+{
+    if (period == 0)
+        return ERROR;
+
+    profStop();
+    profCount  = 0;
+    profEvent  = event;
+    profPeriod = period;
+
+    if (_perfmon_sample(PERF_MON_SAMPLE_COUNTER, event, period,
+                        profSampleHook) != 0)
+        return ERROR;
+
+    return OK;
+}
+
+void profStop(void)
+{
+    _perfmon_sample(PERF_MON_SAMPLE_COUNTER, profEvent, 0, NULL);
+}
+
+/*
+ * profDump()
+ *
+ * Stops sampling and prints the ring, oldest first. Sampling is left off,
+ * call profStart() again for a fresh run.
+ */
+void profDump(void)
+{
+    uint32_t count;
+    uint32_t first;
+    uint32_t i;
+
+    profStop();
+
+    count = profCount;
+    first = (count > PROF_MAX_SAMPLES) ? count - PROF_MAX_SAMPLES : 0;
+
+    iprintf("PROF BEGIN %lu %lu %lu %lu\n\r", profEvent, profPeriod,
+            count - first, first);
+    for (i = first; i < count; i++) {
+        profSample_t *sample = &profSamples[i & (PROF_MAX_SAMPLES - 1)];
+
+        iprintf("PROF %08lx %08lx %s\n\r", sample->pc, sample->lr,
+                sample->thread ? sample->thread : "?");
+    }
+    iprintf("PROF END\n\r");
+}
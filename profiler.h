@@ -0,0 +1,31 @@
+/*******************************************************************************
+ *
+ * profiler.h
+ *
+ * Statistical profiler on the PMU overflow interrupt. See profiler.c and
+ * tools/profsym.py for turning a dump into a profile.
+ *
+ * Copyright (C) 2013 Paul Quevedo
+ *
+ * This program is free software.  It comes without any warranty, to the extent
+ * permitted by applicable law.  You can redistribute it and/or modify it under
+ * the terms of the WTF Public License (WTFPL), Version 2, as published by
+ * Sam Hocevar.  See http://sam.zoy.org/wtfpl/COPYING for more details.
+ *
+ *******************************************************************************/
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+#include "globalDefs.h"
+
+#define PROF_MAX_SAMPLES 4096   /* Power of 2 */
+
+typedef struct {
+    uint32_t    pc;
+    uint32_t    lr;
+    const char *thread;     /* Registry name of the interrupted thread */
+} profSample_t;
+
+extern int  profStart(uint32_t event, uint32_t period);
+extern void profStop (void);
+extern void profDump (void);
+#endif
@@ -19,6 +19,8 @@
 #include "am335x.h"
 #include "hardware.h"
 #include "sdhc.h"
+#include "log.h"
+#include "trace.h"
 
 /* SDPHY_SPEC: Part_1 SD Physical Layer Simplified Specification v3.01 */
 #define CLK_INPUT_FREQ (PER_CLKOUTM2 / 2)
@@ -247,12 +249,10 @@ static void parseCsd(sdhcCard_t *card)
         card->numBlks = (value + 1) * mult;
         card->size = card->numBlks * card->blkLen;
     }
-#if DEBUG
-    iprintf("SDHC Trans Speed: %lu\n\r", card->transSpeed);
-    iprintf("SDHC Block Size:  %lu\n\r", card->blkLen);
-    iprintf("SDHC Num Blocks:  %lu\n\r", card->numBlks);
-    iprintf("SDHC Card Size:   %lu\n\r", card->size);
-#endif
+    LOG_DEBUG("SDHC Trans Speed: %lu\n\r", (unsigned long)card->transSpeed);
+    LOG_DEBUG("SDHC Block Size:  %lu\n\r", (unsigned long)card->blkLen);
+    LOG_DEBUG("SDHC Num Blocks:  %lu\n\r", (unsigned long)card->numBlks);
+    LOG_DEBUG("SDHC Card Size:   %lu\n\r", (unsigned long)card->size);
 }
 
 /*****************************************************************************
@@ -267,10 +267,8 @@ static void parseScr(sdhcCard_t *card)
     card->busWidth  = (value & BIT_2) ? 4 : 1;
     card->sdVersion = (card->scr[0] >> 24) & 0xf;
 
-#if DEBUG
-    iprintf("SDHC SD Version: %d\n\r", card->sdVersion);
-    iprintf("SDHC Bus width:  %d bits\n\r", card->busWidth);
-#endif
+    LOG_DEBUG("SDHC SD Version: %d\n\r", card->sdVersion);
+    LOG_DEBUG("SDHC Bus width:  %d bits\n\r", card->busWidth);
 }
 
 /*****************************************************************************
@@ -313,17 +311,17 @@ static int sdhcSendCmd(uint32_t inst, sdhcCmd_t *cmd)
         SD_SYSCTL(base) |= SD_SYSCTL_DTO(0xe); /* max timeout value */
     }
 
+    TRACE_BEGIN(TRACE_ID_SDHC_CMD + cmd->cmdIdx);
     SD_ARG(base) = cmd->cmdArg;
     SD_CMD(base) = cmdReg;
 
     while (!(SD_STAT(base) & (SD_STAT_ERRI | SD_STAT_CC)))
         ;
+    TRACE_END(TRACE_ID_SDHC_CMD + cmd->cmdIdx);
 
     if (SD_STAT(base) & SD_STAT_ERRI) {
         uartPuts("SDHC Cmd Error");
-#if DEBUG
-        iprintf("   Cmd %d Err %x\n\r", cmd->cmdIdx, SD_STAT(base));
-#endif
+        LOG_DEBUG("   Cmd %d Err %x\n\r", cmd->cmdIdx, SD_STAT(base));
         SD_STAT(base) |= SD_STAT_ERROR_BITS;
         memset(cmd->resp, 0, 16);
         return ERROR;
@@ -337,10 +335,8 @@ static int sdhcSendCmd(uint32_t inst, sdhcCmd_t *cmd)
         cmd->resp[3] = SD_RSP76(base);
     }
 
-#if DEBUG
-    iprintf("SDHC Cmd %d Rsp %08x %08x %08x %08x\n\r", cmd->cmdIdx,
+    LOG_DEBUG("SDHC Cmd %d Rsp %08x %08x %08x %08x\n\r", cmd->cmdIdx,
                         cmd->resp[0], cmd->resp[1], cmd->resp[2], cmd->resp[3]);
-#endif
 
     return OK;
 }
@@ -367,9 +363,7 @@ bool32_t sdhcCardPresent(uint32_t inst)
     else
         present = FALSE;
 
-#if DEBUG
-    iprintf("SDHC Card present? %d\n\r", present);
-#endif
+    LOG_DEBUG("SDHC Card present? %d\n\r", present);
     return present;
 }
 
@@ -417,9 +411,7 @@ int32_t sdhcInit(uint32_t inst)
     }
 
     if (!sdhcCardPresent(inst)) {
-#if DEBUG
-        iprintf("SDHC No Card Detected\n\r");
-#endif
+        LOG_DEBUG("SDHC No Card Detected\n\r");
         return ERROR;
     }
 
@@ -619,9 +611,7 @@ int32_t sdhcOpen(sdhcCard_t *card)
         SD_SYSCTL(base) = value;
         while (!(SD_SYSCTL(base) & SD_SYSCTL_ICS))
             ;
-#if DEBUG
-        iprintf("SDHC running at %dMBits\n\r", freq / 1000000);
-#endif
+        LOG_DEBUG("SDHC running at %dMBits\n\r", freq / 1000000);
     }
 #else
     {
@@ -633,9 +623,7 @@ int32_t sdhcOpen(sdhcCard_t *card)
         SD_HCTL(base) &= ~SD_HCTL_HSPE;
         while (!(SD_SYSCTL(base) & SD_SYSCTL_ICS))
             ;
-#if DEBUG
-        iprintf("SDHC running at %dMBits\n\r", freq / 1000000);
-#endif
+        LOG_DEBUG("SDHC running at %dMBits\n\r", freq / 1000000);
     }
 #endif
 
@@ -652,6 +640,7 @@ int32_t sdhcReadBlock(sdhcCard_t *card, uint32_t block, uint32_t *buffer)
 {
     uint32_t base = inst2Base[card->inst];
 
+    TRACE_BEGIN(TRACE_ID_SDHC_READ);
     cmd17.cmdArg = block;
     sdhcSendCmd(card->inst, &cmd17);
 
@@ -681,6 +670,7 @@ int32_t sdhcReadBlock(sdhcCard_t *card, uint32_t block, uint32_t *buffer)
             break;
         }
     }
+    TRACE_END(TRACE_ID_SDHC_READ);
     return OK;
 }
 
@@ -694,6 +684,7 @@ int32_t sdhcWriteBlock(sdhcCard_t *card, uint32_t block, const uint32_t *buffer)
 {
     uint32_t base = inst2Base[card->inst];
 
+    TRACE_BEGIN(TRACE_ID_SDHC_WRITE);
     cmd24.cmdArg = block;
     sdhcSendCmd(card->inst, &cmd24);
 
@@ -714,5 +705,6 @@ int32_t sdhcWriteBlock(sdhcCard_t *card, uint32_t block, const uint32_t *buffer)
             break;
         }
     }
+    TRACE_END(TRACE_ID_SDHC_WRITE);
     return OK;
 }
@@ -0,0 +1,49 @@
+/*******************************************************************************
+ *
+ * sim.h
+ *
+ * Host simulation of the am335x peripherals the drivers use. See simregs.c
+ *
+ * Copyright (C) 2013 Paul Quevedo
+ *
+ * This program is free software.  It comes without any warranty, to the extent
+ * permitted by applicable law.  You can redistribute it and/or modify it under
+ * the terms of the WTF Public License (WTFPL), Version 2, as published by
+ * Sam Hocevar.  See http://sam.zoy.org/wtfpl/COPYING for more details.
+ *
+ *******************************************************************************/
+#ifndef __SIM_H__
+#define __SIM_H__
+#include "globalDefs.h"
+
+typedef struct simModel simModel_t;
+
+/* A peripheral's register window. read() may have side effects (popping a
+ * FIFO), peek() must not and is what a read-modify-write instruction sees,
+ * leave it NULL if read() is side effect free. */
+struct simModel {
+    const char *name;
+    uint32_t base;
+    uint32_t size;      /* Whole pages */
+    uint32_t (*read) (simModel_t *model, uint32_t offset);
+    uint32_t (*peek) (simModel_t *model, uint32_t offset);
+    void     (*write)(simModel_t *model, uint32_t offset, uint32_t value);
+
+    uint64_t reads;
+    uint64_t writes;
+};
+
+extern int  simInit(void);
+extern int  simAttach(simModel_t *model);
+extern int  simMapMemory(uint32_t base, uint32_t size);
+extern uint64_t simAccesses(void);
+extern void simStats(void);
+
+extern int  simBoardInit(const char *image, const char **ptyName);
+
+/* Models */
+extern int  simUartInit(uint32_t base, const char **ptyName);
+extern int  simUartInject(const uint8_t *data, uint32_t len);
+extern void simUartDiscard(void);
+extern int  simSdhcInit(uint32_t base, const char *image);
+#endif
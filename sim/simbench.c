@@ -0,0 +1,329 @@
+/*******************************************************************************
+ *
+ * simbench.c
+ *
+ * System benchmarks on the simulated board: the block layer (diskio.c over
+ * sdhc.c), FatFs and the polled uart, each timed one call at a time like
+ * bench/bench.c and reported in the same form
+ *
+ *   BENCH name=<s> iters=<n> bytes=<n> ns_min=<n> ns_med=<n> ns_max=<n>
+ *         regs=<median> [insns=<median>]
+ *
+ * regs is the number of register accesses the models saw and insns the
+ * user space instructions retired (when perf events are available). Both
+ * are exact from run to run, ns includes the cost of the simulation so
+ * only compare it between builds on the same host.
+ *
+ *   simbench [-n iters] image
+ *
+ * Copyright (C) 2013 Paul Quevedo
+ *
+ * This program is free software.  It comes without any warranty, to the extent
+ * permitted by applicable law.  You can redistribute it and/or modify it under
+ * the terms of the WTF Public License (WTFPL), Version 2, as published by
+ * Sam Hocevar.  See http://sam.zoy.org/wtfpl/COPYING for more details.
+ *
+ *******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "globalDefs.h"
+#include "hardware.h"
+#include "ff.h"
+#include "diskio.h"
+#include "bench.h"
+#include "sim.h"
+
+#define BENCH_METRICS   3   /* ns, regs, insns */
+#define BENCH_FILE      "/BENCH.BIN"
+#define BENCH_FILE_SIZE 65536
+
+static uint64_t samples[BENCH_METRICS][BENCH_MAX_ITERS];
+static uint64_t overhead[BENCH_METRICS];
+static uint32_t benchIters;     /* -n, 0 for each benchmark's own */
+static int insnFd = -1;
+
+static uint8_t buf[BENCH_FILE_SIZE];
+static FATFS fatfs;
+static FIL fp;
+
+/****************************
+ * Block layer
+ ****************************/
+static int blkSetup(uint32_t count)
+{
+    /* Blocks 0.. are written back with what's already there */
+    if (disk_initialize(0) != 0 || disk_read(0, buf, 0, count) != RES_OK)
+        return ERROR;
+    return OK;
+}
+
+static void blkReadRun(uint32_t count)
+{
+    disk_read(0, buf, 0, count);
+}
+
+static void blkWriteRun(uint32_t count)
+{
+    disk_write(0, buf, 0, count);
+}
+
+/****************************
+ * FatFs
+ ****************************/
+static int fileSetup(uint32_t size)
+{
+    UINT n;
+
+    memset(buf, 0x5a, sizeof(buf));
+    if (f_open(&fp, BENCH_FILE, FA_READ | FA_WRITE | FA_CREATE_ALWAYS) != FR_OK)
+        return ERROR;
+    if (f_write(&fp, buf, BENCH_FILE_SIZE, &n) != FR_OK || f_sync(&fp) != FR_OK)
+        return ERROR;
+    return OK;
+}
+
+static void fileTeardown(uint32_t size)
+{
+    f_close(&fp);
+}
+
+static void fileReadRun(uint32_t size)
+{
+    UINT n;
+
+    f_lseek(&fp, 0);
+    f_read(&fp, buf, size, &n);
+}
+
+static void fileWriteRun(uint32_t size)
+{
+    UINT n;
+
+    f_lseek(&fp, 0);
+    f_write(&fp, buf, size, &n);
+    f_sync(&fp);
+}
+
+static void fileOpenRun(uint32_t arg)
+{
+    FIL file;
+
+    f_open(&file, BENCH_FILE, FA_READ);
+    f_close(&file);
+}
+
+/****************************
+ * UART
+ ****************************/
+static void uartTxRun(uint32_t size)
+{
+    simUartDiscard();   /* Keep the pty from filling up */
+    uartWrite(UART_CONSOLE, buf, size);
+}
+
+static void uartRxRun(uint32_t size)
+{
+    simUartInject(buf, size);
+    uartRead(UART_CONSOLE, buf, size);
+}
+
+/****************************
+ * Suite
+ ****************************/
+static const bench_t suite[] = {
+    { .name = "blk_read_1",  .setup = blkSetup, .run = blkReadRun,
+      .arg = 1,     .bytes = 512,   .iters = 256, },
+    { .name = "blk_read_8",  .setup = blkSetup, .run = blkReadRun,
+      .arg = 8,     .bytes = 4096,  .iters = 128, },
+    { .name = "blk_write_1", .setup = blkSetup, .run = blkWriteRun,
+      .arg = 1,     .bytes = 512,   .iters = 256, },
+    { .name = "blk_write_8", .setup = blkSetup, .run = blkWriteRun,
+      .arg = 8,     .bytes = 4096,  .iters = 128, },
+    { .name = "f_read_4k",   .setup = fileSetup, .run = fileReadRun,
+      .teardown = fileTeardown,
+      .arg = 4096,  .bytes = 4096,  .iters = 128, },
+    { .name = "f_read_64k",  .setup = fileSetup, .run = fileReadRun,
+      .teardown = fileTeardown,
+      .arg = 65536, .bytes = 65536, .iters = 32, },
+    { .name = "f_write_4k",  .setup = fileSetup, .run = fileWriteRun,
+      .teardown = fileTeardown,
+      .arg = 4096,  .bytes = 4096,  .iters = 128, },
+    { .name = "f_write_64k", .setup = fileSetup, .run = fileWriteRun,
+      .teardown = fileTeardown,
+      .arg = 65536, .bytes = 65536, .iters = 32, },
+    { .name = "f_open",      .setup = fileSetup, .run = fileOpenRun,
+      .teardown = fileTeardown,
+      .arg = 0,     .bytes = 0,     .iters = 256, },
+    { .name = "uart_tx_1k",  .run = uartTxRun,
+      .arg = 1024,  .bytes = 1024,  .iters = 64, },
+    { .name = "uart_rx_1k",  .run = uartRxRun,
+      .arg = 1024,  .bytes = 1024,  .iters = 64, },
+};
+
+/****************************
+ * Harness
+ ****************************/
+static void insnInit(void)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size           = sizeof(attr);
+    attr.type           = PERF_TYPE_HARDWARE;
+    attr.config         = PERF_COUNT_HW_INSTRUCTIONS;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+
+    insnFd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static uint64_t insnCount(void)
+{
+    uint64_t count = 0;
+
+    if (insnFd >= 0 && read(insnFd, &count, sizeof(count)) != sizeof(count))
+        count = 0;
+    return count;
+}
+
+static uint64_t nsNow(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int cmpU64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+static void benchNull(uint32_t arg)
+{
+}
+
+/*
+ * benchSample()
+ *
+ * Fills samples[] with iters timed calls of run, each metric sorted
+ */
+static void benchSample(void (*run)(uint32_t), uint32_t arg, uint32_t iters)
+{
+    uint64_t start[BENCH_METRICS];
+    uint32_t i;
+    int m;
+
+    for (i = 0; i < BENCH_WARMUP; i++)
+        run(arg);
+
+    for (i = 0; i < iters; i++) {
+        start[2] = insnCount();
+        start[1] = simAccesses();
+        start[0] = nsNow();
+        run(arg);
+        samples[0][i] = nsNow() - start[0];
+        samples[1][i] = simAccesses() - start[1];
+        samples[2][i] = insnCount() - start[2];
+    }
+
+    for (m = 0; m < BENCH_METRICS; m++) {
+        qsort(samples[m], iters, sizeof(uint64_t), cmpU64);
+        for (i = 0; i < iters; i++)
+            samples[m][i] = (samples[m][i] > overhead[m]) ?
+                             samples[m][i] - overhead[m] : 0;
+    }
+}
+
+static void benchCalibrate(void)
+{
+    int m;
+
+    for (m = 0; m < BENCH_METRICS; m++)
+        overhead[m] = 0;
+
+    benchSample(benchNull, 0, BENCH_MAX_ITERS);
+    for (m = 0; m < BENCH_METRICS; m++)
+        overhead[m] = samples[m][BENCH_MAX_ITERS / 2];
+
+    printf("BENCH overhead ns=%llu\n", (unsigned long long)overhead[0]);
+}
+
+/*
+ * benchRun()
+ *
+ * RETURNS: OK, or ERROR if the benchmark's setup failed
+ */
+int benchRun(const bench_t *bench)
+{
+    uint32_t iters = benchIters ? benchIters : bench->iters;
+
+    LIMIT_VAL(iters, 1, BENCH_MAX_ITERS);
+
+    if (bench->setup && bench->setup(bench->arg) != OK) {
+        printf("BENCH name=%s skipped\n", bench->name);
+        return ERROR;
+    }
+
+    benchSample(bench->run, bench->arg, iters);
+
+    if (bench->teardown)
+        bench->teardown(bench->arg);
+
+    printf("BENCH name=%s iters=%u bytes=%u ns_min=%llu ns_med=%llu"
+           " ns_max=%llu regs=%llu",
+           bench->name, iters, bench->bytes,
+           (unsigned long long)samples[0][0],
+           (unsigned long long)samples[0][iters / 2],
+           (unsigned long long)samples[0][iters - 1],
+           (unsigned long long)samples[1][iters / 2]);
+    if (insnFd >= 0)
+        printf(" insns=%llu", (unsigned long long)samples[2][iters / 2]);
+    printf("\n");
+
+    return OK;
+}
+
+int main(int argc, char **argv)
+{
+    const char *pty;
+    int ran = 0;
+    int opt;
+    int i;
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        switch (opt) {
+        case 'n': benchIters = strtoul(optarg, NULL, 0); break;
+        default:
+            fprintf(stderr, "usage: %s [-n iters] image\n", argv[0]);
+            return 1;
+        }
+    }
+    if (optind >= argc) {
+        fprintf(stderr, "usage: %s [-n iters] image\n", argv[0]);
+        return 1;
+    }
+
+    if (simBoardInit(argv[optind], &pty) != OK || f_mount(0, &fatfs) != FR_OK)
+        return 1;
+    insnInit();
+
+    benchCalibrate();
+    for (i = 0; i < ARRAY_SIZE(suite); i++)
+        if (benchRun(&suite[i]) == OK)
+            ran++;
+
+    printf("BENCH DONE ran=%d skipped=%d\n", ran, (int)ARRAY_SIZE(suite) - ran);
+    return 0;
+}
@@ -0,0 +1,55 @@
+/*******************************************************************************
+ *
+ * simboard.c
+ *
+ * The simulated board: UART0 on a pty, MMC0 with a card image, and plain
+ * memory for the clock control and pinmux windows.
+ *
+ * Copyright (C) 2013 Paul Quevedo
+ *
+ * This program is free software.  It comes without any warranty, to the extent
+ * permitted by applicable law.  You can redistribute it and/or modify it under
+ * the terms of the WTF Public License (WTFPL), Version 2, as published by
+ * Sam Hocevar.  See http://sam.zoy.org/wtfpl/COPYING for more details.
+ *
+ *******************************************************************************/
+#include <stdio.h>
+
+#include "globalDefs.h"
+#include "am335x.h"
+#include "hardware.h"
+#include "sim.h"
+
+/*
+ * simBoardInit()
+ *
+ * Brings up the models and configures the console uart, polled. The pty
+ * standing in for the serial port goes in ptyName.
+ *
+ * RETURNS: OK/ERROR
+ */
+int simBoardInit(const char *image, const char **ptyName)
+{
+    uartCfg_t uartCfg = {
+        .baud = BAUD_115200,
+        .fifo = { .enable = TRUE,
+                  .rxTrig = 1,
+                  .txTrig = 1, },
+    };
+
+    if (simInit() != OK)
+        return ERROR;
+
+    /* Clock control and pinmux only need to hold what's written, apart
+     * from the activity bit uartConfig() waits on */
+    if (simMapMemory(CM_PER_BASE_ADDR, 0x1000) != OK ||
+        simMapMemory(CTRLM_BASE_ADDR,  0x2000) != OK)
+        return ERROR;
+    CM_WKUP_CLKSTCTRL = CM_CLKACTIVITY_UART0_GFCLK;
+
+    if (simUartInit(UART0_BASE_ADDR, ptyName) != OK ||
+        simSdhcInit(MMC0_BASE_ADDR, image) != OK)
+        return ERROR;
+
+    return uartConfig(UART_CONSOLE, &uartCfg);
+}
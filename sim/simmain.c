@@ -0,0 +1,193 @@
+/*******************************************************************************
+ *
+ * simmain.c
+ *
+ * Runs the target's uart.c, sdhc.c, FatFs and xmodem.c on the host against
+ * the register models. Mounts the image, writes and reads back a file
+ * through f_write()/f_read() reporting throughput and register accesses per
+ * block, and optionally receives a file over xmodem on the UART's pty.
+ *
+ *   sim [-k KB] [-x /name] image
+ *
+ * Copyright (C) 2013 Paul Quevedo
+ *
+ * This program is free software.  It comes without any warranty, to the extent
+ * permitted by applicable law.  You can redistribute it and/or modify it under
+ * the terms of the WTF Public License (WTFPL), Version 2, as published by
+ * Sam Hocevar.  See http://sam.zoy.org/wtfpl/COPYING for more details.
+ *
+ *******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "globalDefs.h"
+#include "hardware.h"
+#include "ff.h"
+#include "xmodem.h"
+#include "sim.h"
+
+#define SIM_FILE        "/SIM.BIN"
+#define SIM_CHUNK       4096
+#define SIM_DEFAULT_KB  1024
+
+static uint8_t chunk[SIM_CHUNK];
+static uint8_t check[SIM_CHUNK];
+
+static double simNow(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void simReport(const char *what, uint32_t kb, double start,
+                      uint64_t accesses)
+{
+    double secs = simNow() - start;
+
+    printf("%-6s %6u KB %8.1f ms %8.0f KB/s %6llu accesses/block\n",
+           what, kb, secs * 1000, kb / secs,
+           (unsigned long long)((simAccesses() - accesses) /
+                                (kb * 1024 / 512)));
+}
+
+static int simFileTest(uint32_t kb)
+{
+    FIL fp;
+    UINT n;
+    uint64_t accesses;
+    double start;
+    uint32_t i;
+    uint32_t j;
+
+    if (f_open(&fp, SIM_FILE, FA_WRITE | FA_CREATE_ALWAYS) != FR_OK)
+        return ERROR;
+
+    start    = simNow();
+    accesses = simAccesses();
+    for (i = 0; i < kb * 1024 / SIM_CHUNK; i++) {
+        for (j = 0; j < SIM_CHUNK; j++)
+            chunk[j] = i + j * 7;
+        if (f_write(&fp, chunk, SIM_CHUNK, &n) != FR_OK || n != SIM_CHUNK)
+            return ERROR;
+    }
+    if (f_close(&fp) != FR_OK)
+        return ERROR;
+    simReport("write", kb, start, accesses);
+
+    if (f_open(&fp, SIM_FILE, FA_READ) != FR_OK)
+        return ERROR;
+
+    start    = simNow();
+    accesses = simAccesses();
+    for (i = 0; i < kb * 1024 / SIM_CHUNK; i++) {
+        if (f_read(&fp, check, SIM_CHUNK, &n) != FR_OK || n != SIM_CHUNK)
+            return ERROR;
+        for (j = 0; j < SIM_CHUNK; j++)
+            chunk[j] = i + j * 7;
+        if (memcmp(chunk, check, SIM_CHUNK) != 0) {
+            printf("read back mismatch in chunk %u\n", i);
+            return ERROR;
+        }
+    }
+    f_close(&fp);
+    simReport("read", kb, start, accesses);
+
+    return OK;
+}
+
+/* Same loop as boot.c's loadNewImage() */
+static int simXmodem(const char *path, const char *pty)
+{
+    static uint8_t rxBuffer[1024];
+    xmodemCfg_t cfg = {
+        .numRetries = 0x2000,
+        .uartFd = UART_CONSOLE,
+    };
+    bool32_t started = FALSE;
+    uint32_t total = 0;
+    FIL fp;
+    UINT n;
+
+    if (f_open(&fp, path, FA_WRITE | FA_CREATE_ALWAYS) != FR_OK)
+        return ERROR;
+
+    xmodemInit(&cfg);
+    printf("Waiting for XMODEM on %s, e.g. sx -k file < %s > %s\n",
+           pty, pty, pty);
+
+    while (1) {
+        int len = xmodemRecv(rxBuffer, sizeof(rxBuffer));
+
+        if (len == 0)
+            break;
+        if (len > 0) {
+            started = TRUE;
+            if (f_write(&fp, rxBuffer, len, &n) != FR_OK || n != len) {
+                xmodemAbort();
+                break;
+            }
+            total += len;
+        }
+        else if (started) {
+            xmodemAbort();
+            printf("xmodem: transfer failed after %u bytes\n", total);
+            f_close(&fp);
+            return ERROR;
+        }
+    }
+
+    f_close(&fp);
+    printf("xmodem: %u bytes to %s\n", total, path);
+    return OK;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t kb = SIM_DEFAULT_KB;
+    const char *xmodemPath = NULL;
+    const char *pty;
+    FATFS fatfs;
+    int opt;
+
+    setvbuf(stdout, NULL, _IOLBF, 0);   /* Usually piped to a log */
+
+    while ((opt = getopt(argc, argv, "k:x:")) != -1) {
+        switch (opt) {
+        case 'k': kb = strtoul(optarg, NULL, 0); break;
+        case 'x': xmodemPath = optarg;           break;
+        default:
+            fprintf(stderr, "usage: %s [-k KB] [-x /name] image\n", argv[0]);
+            return 1;
+        }
+    }
+    if (optind >= argc) {
+        fprintf(stderr, "usage: %s [-k KB] [-x /name] image\n", argv[0]);
+        return 1;
+    }
+    kb = (kb + 3) & ~3;     /* Whole chunks */
+
+    if (simBoardInit(argv[optind], &pty) != OK)
+        return 1;
+    printf("UART0 on %s\n", pty);
+
+    if (f_mount(0, &fatfs) != FR_OK) {
+        printf("Mount failed\n");
+        return 1;
+    }
+
+    if (kb && simFileTest(kb) != OK) {
+        printf("File test failed\n");
+        return 1;
+    }
+
+    if (xmodemPath && simXmodem(xmodemPath, pty) != OK)
+        return 1;
+
+    simStats();
+    return 0;
+}
@@ -0,0 +1,208 @@
+/*******************************************************************************
+ *
+ * simregs.c
+ *
+ * Register level peripheral simulation for x86-64 Linux. The drivers are
+ * built unchanged: HWREG32() still dereferences the real physical address.
+ * Each modelled peripheral's window is mapped at that address with no
+ * access rights, so every register access faults:
+ *
+ *   SIGSEGV  The page is opened up and the register slot filled from the
+ *            model, read() for a load or peek() for a store (a read-modify-
+ *            write instruction needs the current value). The trap flag is
+ *            set and the faulting instruction restarted.
+ *   SIGTRAP  Taken after that one instruction. A store's new value is
+ *            handed to the model's write(), the page is closed again and
+ *            the trap flag cleared.
+ *
+ * Several us an access, so wall clock figures aren't representative but
+ * the number of accesses and everything the CPU does between them is.
+ * Windows that only need to hold what was written (pinmux, clock control)
+ * are plain memory, see simMapMemory().
+ *
+ * Copyright (C) 2013 Paul Quevedo
+ *
+ * This program is free software.  It comes without any warranty, to the extent
+ * permitted by applicable law.  You can redistribute it and/or modify it under
+ * the terms of the WTF Public License (WTFPL), Version 2, as published by
+ * Sam Hocevar.  See http://sam.zoy.org/wtfpl/COPYING for more details.
+ *
+ *******************************************************************************/
+#define _GNU_SOURCE
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ucontext.h>
+#include <sys/mman.h>
+
+#include "globalDefs.h"
+#include "sim.h"
+
+#define SIM_MAX_MODELS  8
+#define SIM_PAGE_SIZE   4096
+
+#define X86_EFLAGS_TF   0x100   /* Single step */
+#define X86_PF_WRITE    0x2     /* Page fault error code, access was a store */
+
+static simModel_t *models[SIM_MAX_MODELS];
+static int numModels;
+
+/* The access being single stepped */
+static struct {
+    simModel_t *model;
+    uint32_t offset;
+    bool32_t write;
+} pending;
+
+static simModel_t *simFind(uintptr_t addr)
+{
+    int i;
+
+    for (i = 0; i < numModels; i++)
+        if (addr >= models[i]->base && addr < models[i]->base + models[i]->size)
+            return models[i];
+
+    return NULL;
+}
+
+/* Not ours, or a fault while stepping: let it take the process down */
+static void simUnhandled(int sig)
+{
+    signal(sig, SIG_DFL);
+}
+
+static void simFault(int sig, siginfo_t *info, void *ctx)
+{
+    ucontext_t *uc = ctx;
+    simModel_t *model = simFind((uintptr_t)info->si_addr);
+    volatile uint32_t *reg;
+
+    if (model == NULL || pending.model != NULL) {
+        simUnhandled(sig);
+        return;
+    }
+
+    pending.model  = model;
+    pending.offset = ((uintptr_t)info->si_addr - model->base) & ~0x3;
+    pending.write  = (uc->uc_mcontext.gregs[REG_ERR] & X86_PF_WRITE) != 0;
+
+    reg = (volatile uint32_t *)(uintptr_t)(model->base + pending.offset);
+    mprotect((void *)(uintptr_t)model->base, model->size,
+             PROT_READ | PROT_WRITE);
+
+    if (pending.write) {
+        *reg = model->peek ? model->peek(model, pending.offset)
+                           : model->read(model, pending.offset);
+        model->writes++;
+    }
+    else {
+        *reg = model->read(model, pending.offset);
+        model->reads++;
+    }
+
+    uc->uc_mcontext.gregs[REG_EFL] |= X86_EFLAGS_TF;
+}
+
+static void simStep(int sig, siginfo_t *info, void *ctx)
+{
+    ucontext_t *uc = ctx;
+    simModel_t *model = pending.model;
+
+    if (model == NULL) {
+        simUnhandled(sig);
+        return;
+    }
+
+    if (pending.write)
+        model->write(model, pending.offset,
+                     *(volatile uint32_t *)(uintptr_t)(model->base +
+                                                       pending.offset));
+
+    mprotect((void *)(uintptr_t)model->base, model->size, PROT_NONE);
+    uc->uc_mcontext.gregs[REG_EFL] &= ~X86_EFLAGS_TF;
+    pending.model = NULL;
+}
+
+static int simMap(uint32_t base, uint32_t size, int prot)
+{
+    void *addr = mmap((void *)(uintptr_t)base, size, prot,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+
+    if (addr != (void *)(uintptr_t)base) {
+        fprintf(stderr, "sim: can't map 0x%08x, %s\n", base,
+                addr == MAP_FAILED ? strerror(errno) : "moved");
+        return ERROR;
+    }
+    return OK;
+}
+
+int simInit(void)
+{
+    struct sigaction sa;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_flags = SA_SIGINFO;
+
+    sa.sa_sigaction = simFault;
+    if (sigaction(SIGSEGV, &sa, NULL) != 0)
+        return ERROR;
+
+    sa.sa_sigaction = simStep;
+    if (sigaction(SIGTRAP, &sa, NULL) != 0)
+        return ERROR;
+
+    return OK;
+}
+
+/*
+ * simAttach()
+ *
+ * Maps model's window at its physical address, inaccessible
+ */
+int simAttach(simModel_t *model)
+{
+    if (numModels >= SIM_MAX_MODELS ||
+        (model->base | model->size) & (SIM_PAGE_SIZE - 1))
+        return ERROR;
+
+    if (simMap(model->base, model->size, PROT_NONE) != OK)
+        return ERROR;
+
+    models[numModels++] = model;
+    return OK;
+}
+
+/*
+ * simMapMemory()
+ *
+ * Maps zeroed read/write memory at a physical address, for registers that
+ * just hold their value
+ */
+int simMapMemory(uint32_t base, uint32_t size)
+{
+    return simMap(base, size, PROT_READ | PROT_WRITE);
+}
+
+uint64_t simAccesses(void)
+{
+    uint64_t total = 0;
+    int i;
+
+    for (i = 0; i < numModels; i++)
+        total += models[i]->reads + models[i]->writes;
+
+    return total;
+}
+
+void simStats(void)
+{
+    int i;
+
+    printf("%-8s %12s %12s\n", "MODEL", "READS", "WRITES");
+    for (i = 0; i < numModels; i++)
+        printf("%-8s %12llu %12llu\n", models[i]->name,
+               (unsigned long long)models[i]->reads,
+               (unsigned long long)models[i]->writes);
+}
@@ -0,0 +1,353 @@
+/*******************************************************************************
+ *
+ * simsdhc.c
+ *
+ * MMCHS model with an SDHC card backed by a disk image. Implements the
+ * commands sdhc.c sends: 0, 2, 3, 7, 8, 9, 17, 24, 55 and ACMD 6, 41, 51.
+ * Anything else times out (SD_STAT.CTO).
+ *
+ * Data moves through SD_DATA one 32 bit word at a time like the real FIFO.
+ * BRR is only raised once the driver has acknowledged CC, the card takes a
+ * while to start sending on hardware too and sdhc.c relies on it: its
+ * "SD_STAT |= CC" writes back, and so clears, every pending bit. TC follows
+ * the last word of the block. SD_STAT bits are write one to clear and ERRI
+ * is the OR of the error bits.
+ *
+ * The image is the card's user area, rounded down to the 512KB units the
+ * CSD v2 C_SIZE field counts in.
+ *
+ * Copyright (C) 2013 Paul Quevedo
+ *
+ * This program is free software.  It comes without any warranty, to the extent
+ * permitted by applicable law.  You can redistribute it and/or modify it under
+ * the terms of the WTF Public License (WTFPL), Version 2, as published by
+ * Sam Hocevar.  See http://sam.zoy.org/wtfpl/COPYING for more details.
+ *
+ *******************************************************************************/
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "globalDefs.h"
+#include "am335x.h"
+#include "sim.h"
+
+#define SDHC_WINDOW     0x1000
+#define SD_BLOCK_SIZE   512
+#define SD_CSIZE_UNIT   (512 * 1024)
+#define SD_RCA          0x5D5D0000
+
+/* R1 card status, SDPHY_SPEC s4.10.1 */
+#define R1_OUT_OF_RANGE     BIT_31
+#define R1_STATE(state)     ((state) << 9)
+#define R1_READY_FOR_DATA   BIT_8
+#define R1_APP_CMD          BIT_5
+
+#define OCR_CARD_READY      BIT_31
+#define OCR_HIGH_CAPACITY   BIT_30
+#define OCR_VDD_2V7_3V6     (0x1ff << 15)
+
+enum {
+    CARD_IDLE,
+    CARD_READY,
+    CARD_IDENT,
+    CARD_STBY,
+    CARD_TRAN,
+    CARD_DATA,
+    CARD_RCV,
+};
+
+enum {
+    XFER_NONE,
+    XFER_READ,
+    XFER_WRITE,
+};
+
+static struct {
+    simModel_t model;
+    int fd;
+    uint32_t numBlks;
+    uint32_t cardState;
+    bool32_t appCmd;
+
+    uint32_t stat;
+    uint32_t rsp[4];
+    uint32_t regs[SDHC_WINDOW / 4];
+
+    uint32_t xfer;
+    uint32_t xferBlock;
+    bool32_t xferReady;     /* BRR raised for this block */
+    uint32_t bufLen;
+    uint32_t bufPos;
+    uint8_t  buf[SD_BLOCK_SIZE];
+} sd;
+
+#define REG(offset) sd.regs[(offset) / 4]
+
+static const uint32_t cid[4] = {    /* Made up, CID[31:0] first */
+    0x13014201, 0x00000101, 0x53494d30, 0x03534430,
+};
+
+static void sdReset(void)
+{
+    memset(sd.regs, 0, sizeof(sd.regs));
+    memset(sd.rsp, 0, sizeof(sd.rsp));
+    sd.stat   = 0;
+    sd.xfer   = XFER_NONE;
+    sd.appCmd = FALSE;
+}
+
+static uint32_t sdR1(void)
+{
+    return R1_STATE(sd.cardState) | R1_READY_FOR_DATA |
+           (sd.appCmd ? R1_APP_CMD : 0);
+}
+
+/* CSD v2.0, SDPHY_SPEC s5.3.3. csd[n] is CSD[32n+31:32n] */
+static void sdCsd(uint32_t *csd)
+{
+    uint32_t cSize = sd.numBlks / (SD_CSIZE_UNIT / SD_BLOCK_SIZE) - 1;
+
+    csd[3] = (0x1 << 30)            /* CSD_STRUCTURE v2.0 */
+           | (0x0E << 16)           /* TAAC 1ms */
+           | 0x32;                  /* TRAN_SPEED 25MHz */
+    csd[2] = (0x5B5 << 20)          /* CCC */
+           | (9 << 16)              /* READ_BL_LEN 512 */
+           | ((cSize >> 16) & 0x3f);
+    csd[1] = ((cSize & 0xffff) << 16)
+           | BIT_14                 /* ERASE_BLK_EN */
+           | (0x7f << 7);           /* SECTOR_SIZE */
+    csd[0] = (0x2 << 26)            /* R2W_FACTOR */
+           | (9 << 22)              /* WRITE_BL_LEN 512 */
+           | BIT_0;
+}
+
+static void sdStartRead(uint32_t block)
+{
+    memset(sd.buf, 0, sizeof(sd.buf));
+    if (block < sd.numBlks &&
+        pread(sd.fd, sd.buf, SD_BLOCK_SIZE, (off_t)block * SD_BLOCK_SIZE) < 0)
+        perror("sim: sd image read");
+
+    sd.xfer      = XFER_READ;
+    sd.xferReady = FALSE;
+    sd.bufLen    = SD_BLOCK_SIZE;
+    sd.bufPos    = 0;
+}
+
+static void sdStartWrite(uint32_t block)
+{
+    sd.xfer      = XFER_WRITE;
+    sd.xferBlock = block;
+    sd.bufLen    = SD_BLOCK_SIZE;
+    sd.bufPos    = 0;
+}
+
+static void sdCommand(uint32_t cmd)
+{
+    uint32_t idx = (cmd >> 24) & 0x3f;
+    uint32_t arg = REG(0x208);
+    bool32_t app = sd.appCmd;
+
+    /* 80 clock initialisation stream, not a command */
+    if (REG(0x12C) & SD_CON_INIT) {
+        sd.stat |= SD_STAT_CC;
+        return;
+    }
+
+    /* Undefined ACMDs are taken as the standard command */
+    if (app && idx != 6 && idx != 41 && idx != 51)
+        app = FALSE;
+
+    memset(sd.rsp, 0, sizeof(sd.rsp));
+    sd.appCmd = FALSE;
+
+    switch (app ? idx | 0x40 : idx) {
+    case 0:
+        sd.cardState = CARD_IDLE;
+        break;
+    case 2:
+        memcpy(sd.rsp, cid, sizeof(sd.rsp));
+        sd.cardState = CARD_IDENT;
+        break;
+    case 3:
+        sd.rsp[0] = SD_RCA | (sdR1() & 0xffff);
+        sd.cardState = CARD_STBY;
+        break;
+    case 7:
+        sd.rsp[0] = sdR1();
+        sd.cardState = (arg == SD_RCA) ? CARD_TRAN : CARD_STBY;
+        break;
+    case 8:
+        sd.rsp[0] = arg & 0xfff;    /* Voltage accepted, check pattern */
+        break;
+    case 9:
+        sdCsd(sd.rsp);
+        break;
+    case 17:
+        sd.rsp[0] = sdR1() | (arg >= sd.numBlks ? R1_OUT_OF_RANGE : 0);
+        sdStartRead(arg);
+        break;
+    case 24:
+        sd.rsp[0] = sdR1() | (arg >= sd.numBlks ? R1_OUT_OF_RANGE : 0);
+        sdStartWrite(arg);
+        break;
+    case 55:
+        sd.appCmd = TRUE;
+        sd.rsp[0] = sdR1();
+        break;
+    case 6 | 0x40:
+        sd.rsp[0] = sdR1() | R1_APP_CMD;
+        break;
+    case 41 | 0x40:
+        sd.rsp[0] = OCR_CARD_READY | OCR_HIGH_CAPACITY | OCR_VDD_2V7_3V6;
+        sd.cardState = CARD_READY;
+        break;
+    case 51 | 0x40:
+        sd.rsp[0] = sdR1() | R1_APP_CMD;
+        memset(sd.buf, 0, sizeof(sd.buf));
+        sd.buf[0] = 0x02;           /* SCR v1.0, SD spec 2.00 */
+        sd.buf[1] = 0x05;           /* 1 and 4 bit bus */
+        sd.xfer      = XFER_READ;
+        sd.xferReady = FALSE;
+        sd.bufLen    = 8;
+        sd.bufPos    = 0;
+        break;
+    default:
+        sd.stat |= SD_STAT_CTO;
+        return;
+    }
+
+    sd.stat |= SD_STAT_CC;
+    if (sd.xfer == XFER_WRITE)
+        sd.stat |= SD_STAT_BWR;
+}
+
+static uint32_t sdPeek(simModel_t *model, uint32_t offset)
+{
+    uint32_t value;
+
+    switch (offset) {
+    case 0x114: /* SYSSTATUS */
+        return SD_SYSSTATUS_RESETDONE;
+    case 0x210: return sd.rsp[0];
+    case 0x214: return sd.rsp[1];
+    case 0x218: return sd.rsp[2];
+    case 0x21C: return sd.rsp[3];
+    case 0x224: /* PSTATE */
+        value = (sd.fd >= 0) ? SD_PSTATE_CINS : 0;
+        if (sd.xfer == XFER_READ && sd.xferReady)
+            value |= SD_PSTATE_BRE;
+        if (sd.xfer == XFER_WRITE)
+            value |= SD_PSTATE_BWE;
+        return value;
+    case 0x230: /* STAT */
+        return sd.stat | ((sd.stat & SD_STAT_ERROR_BITS) ? SD_STAT_ERRI : 0);
+    }
+    return REG(offset);
+}
+
+static uint32_t sdRead(simModel_t *model, uint32_t offset)
+{
+    uint32_t value;
+
+    switch (offset) {
+    case 0x220: /* DATA */
+        if (sd.xfer != XFER_READ || !sd.xferReady)
+            return 0;
+        memcpy(&value, &sd.buf[sd.bufPos], 4);  /* FIFO is little endian */
+        sd.bufPos += 4;
+        if (sd.bufPos >= sd.bufLen) {
+            sd.xfer  = XFER_NONE;
+            sd.stat |= SD_STAT_TC;
+        }
+        return value;
+    case 0x230: /* STAT */
+        if (sd.xfer == XFER_READ && !sd.xferReady && !(sd.stat & SD_STAT_CC)) {
+            sd.xferReady = TRUE;
+            sd.stat |= SD_STAT_BRR;
+        }
+        break;
+    }
+    return sdPeek(model, offset);
+}
+
+static void sdWrite(simModel_t *model, uint32_t offset, uint32_t value)
+{
+    switch (offset) {
+    case 0x110: /* SYSCONFIG */
+        if (value & SD_SYSCONFIG_SOFTRESET)
+            sdReset();
+        REG(offset) = value & ~SD_SYSCONFIG_SOFTRESET;
+        return;
+    case 0x20C: /* CMD */
+        REG(offset) = value;
+        sdCommand(value);
+        return;
+    case 0x220: /* DATA */
+        if (sd.xfer != XFER_WRITE)
+            return;
+        memcpy(&sd.buf[sd.bufPos], &value, 4);
+        sd.bufPos += 4;
+        if (sd.bufPos >= sd.bufLen) {
+            if (sd.xferBlock < sd.numBlks &&
+                pwrite(sd.fd, sd.buf, SD_BLOCK_SIZE,
+                       (off_t)sd.xferBlock * SD_BLOCK_SIZE) < 0)
+                perror("sim: sd image write");
+            sd.xfer  = XFER_NONE;
+            sd.stat |= SD_STAT_TC;
+        }
+        return;
+    case 0x22C: /* SYSCTL */
+        if (value & (SD_SYSCTL_SRA | SD_SYSCTL_SRD))
+            sd.xfer = XFER_NONE;
+        value &= ~(SD_SYSCTL_SRA | SD_SYSCTL_SRC | SD_SYSCTL_SRD);
+        if (value & SD_SYSCTL_ICE)
+            value |= SD_SYSCTL_ICS;
+        REG(offset) = value;
+        return;
+    case 0x230: /* STAT, write one to clear */
+        sd.stat &= ~value;
+        return;
+    }
+    REG(offset) = value;
+}
+
+/*
+ * simSdhcInit()
+ *
+ * Models the MMCHS at base with a card backed by image, or no card if
+ * image is NULL
+ */
+int simSdhcInit(uint32_t base, const char *image)
+{
+    struct stat st;
+
+    sd.fd = -1;
+    if (image != NULL) {
+        sd.fd = open(image, O_RDWR);
+        if (sd.fd < 0 || fstat(sd.fd, &st) != 0) {
+            perror(image);
+            return ERROR;
+        }
+        sd.numBlks = (st.st_size / SD_CSIZE_UNIT) * (SD_CSIZE_UNIT /
+                                                     SD_BLOCK_SIZE);
+        if (sd.numBlks == 0) {
+            fprintf(stderr, "%s: smaller than 512KB\n", image);
+            return ERROR;
+        }
+    }
+    sdReset();
+
+    sd.model.name  = "sdhc";
+    sd.model.base  = base;
+    sd.model.size  = SDHC_WINDOW;
+    sd.model.read  = sdRead;
+    sd.model.peek  = sdPeek;
+    sd.model.write = sdWrite;
+
+    return simAttach(&sd.model);
+}
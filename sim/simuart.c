@@ -0,0 +1,184 @@
+/*******************************************************************************
+ *
+ * simuart.c
+ *
+ * UART model backed by a pty. THR writes go out the master side, RHR reads
+ * and LSR.RXFIFOE come from it, so anything that speaks to a serial port
+ * (sx, screen) can be pointed at the slave. Writes are never held up: the
+ * FIFO never fills and the shift register is always empty, bytes nobody
+ * reads are dropped like they would be on an unconnected line. The divisor
+ * and line control just hold their values.
+ *
+ * Copyright (C) 2013 Paul Quevedo
+ *
+ * This program is free software.  It comes without any warranty, to the extent
+ * permitted by applicable law.  You can redistribute it and/or modify it under
+ * the terms of the WTF Public License (WTFPL), Version 2, as published by
+ * Sam Hocevar.  See http://sam.zoy.org/wtfpl/COPYING for more details.
+ *
+ *******************************************************************************/
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "globalDefs.h"
+#include "am335x.h"
+#include "sim.h"
+
+#define UART_WINDOW     0x1000
+#define LCR_CONFIG_B    0xBF    /* Exposes EFR at 0x08 */
+
+static struct {
+    simModel_t model;
+    int fd;
+    int slaveFd;        /* Held open so the master doesn't see a hangup */
+    bool32_t rxHeld;    /* One byte of RX FIFO */
+    uint8_t  rxByte;
+    uint32_t ier;       /* Share offsets with DLH/FCR, which live in regs */
+    uint32_t fcr;
+    uint32_t regs[UART_WINDOW / 4];
+    uint32_t dropped;   /* TX bytes with nobody on the slave side */
+} uart;
+
+#define REG(offset) uart.regs[(offset) / 4]
+
+static bool32_t uartRxReady(void)
+{
+    struct pollfd pfd = { .fd = uart.fd, .events = POLLIN };
+
+    if (!uart.rxHeld && poll(&pfd, 1, 0) == 1 &&
+        read(uart.fd, &uart.rxByte, 1) == 1)
+        uart.rxHeld = TRUE;
+
+    return uart.rxHeld;
+}
+
+static uint32_t uartPeek(simModel_t *model, uint32_t offset)
+{
+    uint32_t lcr = REG(0x0C);
+
+    switch (offset) {
+    case 0x00:  /* RHR */
+        return (lcr & UART_LCR_DIV_EN) ? REG(0x00) : uart.rxByte;
+    case 0x04:  /* IER */
+        return (lcr & UART_LCR_DIV_EN) ? REG(0x04) : uart.ier;
+    case 0x08:  /* IIR */
+        return (lcr == LCR_CONFIG_B) ? REG(0x08) : UART_IIR_IT_PENDING;
+    case 0x14:  /* LSR */
+        return UART_LSR_TXSRE | UART_LSR_TXFIFOE |
+               (uart.rxHeld ? UART_LSR_RXFIFOE : 0);
+    case 0x44:  /* SSR */
+        return 0;
+    case 0x58:  /* SYSS */
+        return BIT_0;   /* RESETDONE */
+    }
+    return REG(offset);
+}
+
+static uint32_t uartRead(simModel_t *model, uint32_t offset)
+{
+    uint32_t value;
+
+    if (REG(0x0C) & UART_LCR_DIV_EN)
+        return uartPeek(model, offset);
+
+    switch (offset) {
+    case 0x00:
+        value = uartRxReady() ? uart.rxByte : 0;
+        uart.rxHeld = FALSE;
+        return value;
+    case 0x14:
+        uartRxReady();
+        break;
+    }
+    return uartPeek(model, offset);
+}
+
+static void uartWrite(simModel_t *model, uint32_t offset, uint32_t value)
+{
+    uint8_t byte = value;
+
+    if (REG(0x0C) & UART_LCR_DIV_EN) {
+        REG(offset) = value;    /* DLL, DLH, EFR */
+        return;
+    }
+
+    switch (offset) {
+    case 0x00:  /* THR */
+        if (write(uart.fd, &byte, 1) != 1)
+            uart.dropped++;
+        return;
+    case 0x04:  /* IER */
+        uart.ier = value;
+        return;
+    case 0x08:  /* FCR */
+        if (value & UART_FCR_RX_FIFO_CLEAR) {
+            tcflush(uart.fd, TCIFLUSH);
+            uart.rxHeld = FALSE;
+        }
+        uart.fcr = value & ~(UART_FCR_RX_FIFO_CLEAR | UART_FCR_TX_FIFO_CLEAR);
+        return;
+    }
+    REG(offset) = value;
+}
+
+/*
+ * simUartInit()
+ *
+ * Models the UART at base on a new pty, the slave's path goes in ptyName
+ */
+int simUartInit(uint32_t base, const char **ptyName)
+{
+    struct termios tio;
+
+    uart.fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (uart.fd < 0 || grantpt(uart.fd) != 0 || unlockpt(uart.fd) != 0)
+        return ERROR;
+
+    *ptyName = ptsname(uart.fd);
+    uart.slaveFd = open(*ptyName, O_RDWR | O_NOCTTY);
+    if (uart.slaveFd < 0)
+        return ERROR;
+
+    /* Raw, or the line discipline eats the binary in transfers */
+    tcgetattr(uart.slaveFd, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(uart.slaveFd, TCSANOW, &tio);
+
+    uart.model.name  = "uart";
+    uart.model.base  = base;
+    uart.model.size  = UART_WINDOW;
+    uart.model.read  = uartRead;
+    uart.model.peek  = uartPeek;
+    uart.model.write = uartWrite;
+
+    return simAttach(&uart.model);
+}
+
+/*
+ * simUartInject()
+ *
+ * Sends data down the line from the far end, as if typed on the pty
+ *
+ * RETURNS: Bytes queued
+ */
+int simUartInject(const uint8_t *data, uint32_t len)
+{
+    int n = write(uart.slaveFd, data, len);
+
+    return (n < 0) ? 0 : n;
+}
+
+/*
+ * simUartDiscard()
+ *
+ * Throws away whatever the uart has sent that the far end hasn't read
+ */
+void simUartDiscard(void)
+{
+    tcflush(uart.slaveFd, TCIFLUSH);
+}
@@ -0,0 +1,156 @@
+/*******************************************************************************
+ *
+ * thdstats.c
+ *
+ * Per-thread PMU accounting. THREAD_CONTEXT_SWITCH_HOOK (chconf.h) snapshots
+ * the cycle counter and the event counters on every switch and charges the
+ * difference since the previous switch to the thread being switched out.
+ * ISRs are charged to whichever thread they interrupted.
+ *
+ * threadStatsDump() prints a top style view of the registry covering the
+ * time since the previous dump.
+ *
+ * Copyright (C) 2013 Paul Quevedo
+ *
+ * This program is free software.  It comes without any warranty, to the extent
+ * permitted by applicable law.  You can redistribute it and/or modify it under
+ * the terms of the WTF Public License (WTFPL), Version 2, as published by
+ * Sam Hocevar.  See http://sam.zoy.org/wtfpl/COPYING for more details.
+ *
+ *******************************************************************************/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "arm/perfmon.h"
+
+#include "ch.h"
+
+#include "globalDefs.h"
+#include "thdstats.h"
+
+static const char *const stateNames[] = { THD_STATE_NAMES };
+
+static const char *const *statNames;    /* NULL entries aren't shown */
+static perfmonSnapshot_t switchLast;    /* Counters at the last switch */
+static perfmonSnapshot_t switchNow;     /* threadStatsSwitch()'s, off the
+                                         * switched out thread's stack */
+static perfmonSnapshot_t dumpLast;      /* Counters at the last dump */
+static volatile bool32_t statsOn;
+
+/* Kernel locked */
+static void threadStatsCharge(Thread *tp, const perfmonSnapshot_t *now)
+{
+    threadStats_t *stats = &tp->p_stats;
+    int i;
+
+    stats->pmu.cycles += now->cycles - switchLast.cycles;
+    for (i = 0; i < PERF_MON_MAX_COUNTERS; i++)
+        stats->pmu.events[i] += now->events[i] - switchLast.events[i];
+
+    switchLast = *now;
+}
+
+/*
+ * threadStatsInit()
+ *
+ * Starts accounting. The PMU must already be set up. eventNames labels
+ * each of the PERF_MON_MAX_COUNTERS event counters in the dump, leave an
+ * entry NULL to hide a counter that is unused or sampling.
+ */
+void threadStatsInit(const char *const eventNames[])
+{
+    chSysLock();
+    statNames = eventNames;
+    _perfmon_snapshot(&switchLast);
+    dumpLast = switchLast;
+    statsOn  = TRUE;
+    chSysUnlock();
+}
+
+void threadStatsClear(Thread *tp)
+{
+    memset(&tp->p_stats,     0, sizeof(tp->p_stats));
+    memset(&tp->p_statsLast, 0, sizeof(tp->p_statsLast));
+}
+
+/*
+ * threadStatsSwitch()
+ *
+ * THREAD_CONTEXT_SWITCH_HOOK, kernel locked and possibly from the IRQ
+ * epilogue. Five counter reads per switch. Runs on the stack of the thread
+ * being switched out, idle's included, so the snapshot is kept static.
+ */
+void threadStatsSwitch(Thread *ntp, Thread *otp)
+{
+    if (!statsOn)
+        return;
+
+    _perfmon_snapshot(&switchNow);
+    threadStatsCharge(otp, &switchNow);
+    ntp->p_stats.switches++;
+}
+
+/*
+ * threadStatsDump()
+ *
+ * One line per thread for the interval since the last dump: cpu share,
+ * cycles, switches in and each named event, counts in thousands.
+ */
+void threadStatsDump(void)
+{
+    perfmonSnapshot_t now;
+    threadStats_t delta;
+    uint64_t interval;
+    uint32_t share;
+    Thread *tp;
+    int i;
+
+    if (!statsOn)
+        return;
+
+    /* Bring ourselves up to date, we've been running since our switch in */
+    chSysLock();
+    _perfmon_snapshot(&now);
+    threadStatsCharge(currp, &now);
+    chSysUnlock();
+
+    interval = now.cycles - dumpLast.cycles;
+    dumpLast = now;
+    if (interval == 0)
+        return;
+
+    iprintf("TOP %lu kcycles, event counts in thousands\n\r",
+            (uint32_t)(interval / 1000));
+    iprintf("%-12s %4s %-8s %6s %10s %8s", "THREAD", "PRIO", "STATE",
+            "CPU%", "KCYCLES", "SWITCHES");
+    for (i = 0; i < PERF_MON_MAX_COUNTERS; i++)
+        if (statNames[i] != NULL)
+            iprintf(" %10s", statNames[i]);
+    iprintf("\n\r");
+
+    tp = chRegFirstThread();
+    while (tp != NULL) {
+        chSysLock();
+        delta.pmu.cycles = tp->p_stats.pmu.cycles - tp->p_statsLast.pmu.cycles;
+        for (i = 0; i < PERF_MON_MAX_COUNTERS; i++)
+            delta.pmu.events[i] = tp->p_stats.pmu.events[i] -
+                                  tp->p_statsLast.pmu.events[i];
+        delta.switches = tp->p_stats.switches - tp->p_statsLast.switches;
+        tp->p_statsLast = tp->p_stats;
+        chSysUnlock();
+
+        /* Tenths of a percent */
+        share = (uint32_t)((delta.pmu.cycles * 1000) / interval);
+
+        iprintf("%-12s %4lu %-8s %4lu.%lu %10lu %8lu",
+                tp->p_name ? tp->p_name : "?", (uint32_t)tp->p_prio,
+                stateNames[tp->p_state], share / 10, share % 10,
+                (uint32_t)(delta.pmu.cycles / 1000), delta.switches);
+        for (i = 0; i < PERF_MON_MAX_COUNTERS; i++)
+            if (statNames[i] != NULL)
+                iprintf(" %10lu", (uint32_t)(delta.pmu.events[i] / 1000));
+        iprintf("\n\r");
+
+        tp = chRegNextThread(tp);
+    }
+}
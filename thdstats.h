@@ -0,0 +1,32 @@
+/*******************************************************************************
+ *
+ * thdstats.h
+ *
+ * Per-thread PMU accounting, charged on every context switch. Included by
+ * chconf.h for the Thread fields, so no kernel headers in here.
+ *
+ * Copyright (C) 2013 Paul Quevedo
+ *
+ * This program is free software.  It comes without any warranty, to the extent
+ * permitted by applicable law.  You can redistribute it and/or modify it under
+ * the terms of the WTF Public License (WTFPL), Version 2, as published by
+ * Sam Hocevar.  See http://sam.zoy.org/wtfpl/COPYING for more details.
+ *
+ *******************************************************************************/
+#ifndef __THDSTATS_H__
+#define __THDSTATS_H__
+#include <stdint.h>
+#include "arm/perfmon.h"
+
+typedef struct {
+    perfmonSnapshot_t pmu;      /* Counts while this thread was running */
+    uint32_t          switches; /* Times it was switched in */
+} threadStats_t;
+
+struct Thread;
+
+extern void threadStatsInit  (const char *const eventNames[]);
+extern void threadStatsClear (struct Thread *tp);
+extern void threadStatsSwitch(struct Thread *ntp, struct Thread *otp);
+extern void threadStatsDump  (void);
+#endif
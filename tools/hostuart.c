@@ -0,0 +1,91 @@
+/******************************************************************************
+ *
+ * hostuart.c
+ *
+ * uartRead()/uartWrite() for host builds. Lets the target side protocol
+ * modules (boot/smodem.c) run on Linux against a tty or pty file descriptor.
+ * Reads keep the target semantics: each byte waits a short while and a
+ * short count is returned on timeout.
+ *
+ * Copyright (C) 2013 Paul Quevedo
+ *
+ * This program is free software.  It comes without any warranty, to the extent
+ * permitted by applicable law.  You can redistribute it and/or modify it under
+ * the terms of the WTF Public License (WTFPL), Version 2, as published by
+ * Sam Hocevar.  See http://sam.zoy.org/wtfpl/COPYING for more details.
+ *
+ *****************************************************************************/
+#include <errno.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "globalDefs.h"
+#include "hardware.h"
+#include "hostuart.h"
+#include "serial.h"
+
+/* Per byte read timeout, roughly what the 1000 LSR polls in uart.c give */
+#define BYTE_TIMEOUT_MS 1
+
+static int uartFds[MAX_UARTS] = { -1, -1, -1, -1, -1, -1 };
+
+void hostUartAttach(uint32_t inst, int fd)
+{
+    uartFds[inst] = fd;
+}
+
+int uartWrite(uint32_t inst, uint8_t *data, uint32_t len)
+{
+    uint32_t txLen = 0;
+
+    if (uartFds[inst] < 0)
+        return 0;
+
+    while (txLen < len) {
+        ssize_t n = write(uartFds[inst], data + txLen, len - txLen);
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN)
+                continue;
+            break;
+        }
+        txLen += n;
+    }
+    return txLen;
+}
+
+int uartRead(uint32_t inst, uint8_t *data, uint32_t len)
+{
+    struct pollfd pfd = { .fd = uartFds[inst], .events = POLLIN };
+    uint32_t rxLen = 0;
+
+    if (uartFds[inst] < 0)
+        return 0;
+
+    while (rxLen < len) {
+        ssize_t n;
+
+        if (poll(&pfd, 1, BYTE_TIMEOUT_MS) <= 0)
+            break;
+        n = read(uartFds[inst], data + rxLen, len - rxLen);
+        if (n <= 0)
+            break;
+        rxLen += n;
+    }
+    return rxLen;
+}
+
+int uartSetRate(uint32_t inst, uint32_t rate)
+{
+    if (uartFds[inst] < 0)
+        return ERROR;
+
+    tcdrain(uartFds[inst]);
+    return serialSetBaud(uartFds[inst], rate) < 0 ? ERROR : OK;
+}
+
+void uartDrain(uint32_t inst)
+{
+    if (uartFds[inst] >= 0)
+        tcdrain(uartFds[inst]);
+}
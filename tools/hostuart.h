@@ -0,0 +1,18 @@
+/*******************************************************************************
+ *
+ * hostuart.h
+ *
+ * Copyright (C) 2013 Paul Quevedo
+ *
+ * This program is free software.  It comes without any warranty, to the extent
+ * permitted by applicable law.  You can redistribute it and/or modify it under
+ * the terms of the WTF Public License (WTFPL), Version 2, as published by
+ * Sam Hocevar.  See http://sam.zoy.org/wtfpl/COPYING for more details.
+ *
+ *******************************************************************************/
+#ifndef __HOSTUART_H__
+#define __HOSTUART_H__
+#include "globalDefs.h"
+
+extern void hostUartAttach(uint32_t inst, int fd);
+#endif
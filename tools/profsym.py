@@ -0,0 +1,136 @@
+#!/usr/bin/env python3
+################################################################################
+#
+# profsym.py
+#
+# Symbolizes a profiler dump (profiler.c) captured off the console against
+# the application image.
+#
+#   profsym.py [-e app.axf] [-m flat|callers|folded] [-n N] <log>
+#
+#   flat     Self time per function, highest first (default)
+#   callers  Self time per (function <- caller) pair. The caller comes from
+#            the sampled lr so it is only right in leaf functions, in others
+#            lr is whatever the last call left there.
+#   folded   thread;caller;function count lines for flamegraph.pl
+#
+# Copyright (C) 2013 Paul Quevedo
+#
+# This program is free software.  It comes without any warranty, to the extent
+# permitted by applicable law.  You can redistribute it and/or modify it under
+# the terms of the WTF Public License (WTFPL), Version 2, as published by
+# Sam Hocevar.  See http://sam.zoy.org/wtfpl/COPYING for more details.
+#
+################################################################################
+
+import argparse
+import bisect
+import collections
+import os
+import subprocess
+import sys
+
+NM = os.environ.get('NM', 'arm-none-eabi-nm')
+
+
+class Symbols:
+    def __init__(self, elf):
+        out = subprocess.run([NM, '-n', '-S', '--defined-only', elf],
+                             check=True, stdout=subprocess.PIPE,
+                             universal_newlines=True).stdout
+        self.addrs = []
+        self.names = []
+        self.ends  = []
+        for line in out.splitlines():
+            fields = line.split()
+            if len(fields) == 4:
+                addr, size, kind, name = fields
+            elif len(fields) == 3:
+                addr, kind, name = fields
+                size = '0'
+            else:
+                continue
+            if kind not in 'tTwW':
+                continue
+            # Skip ARM mapping symbols ($a, $t, $d)
+            if name.startswith('$'):
+                continue
+            self.addrs.append(int(addr, 16))
+            self.ends.append(int(addr, 16) + int(size, 16))
+            self.names.append(name)
+
+    def lookup(self, addr):
+        i = bisect.bisect_right(self.addrs, addr) - 1
+        if i < 0:
+            return '0x%08x' % addr
+        # Unsized symbols (assembly) own everything up to the next one
+        if self.ends[i] != self.addrs[i] and addr >= self.ends[i]:
+            return '0x%08x' % addr
+        return self.names[i]
+
+
+def readSamples(f):
+    samples = []
+    header = None
+    for line in f:
+        # Console lines end in \n\r, and may carry a LOG timestamp prefix
+        fields = line.strip().split()
+        if 'PROF' not in fields:
+            continue
+        fields = fields[fields.index('PROF') + 1:]
+        if not fields:
+            continue
+        if fields[0] == 'BEGIN':
+            header = [int(x) for x in fields[1:5]]
+            samples = []
+        elif fields[0] == 'END':
+            break
+        elif len(fields) >= 3:
+            try:
+                pc = int(fields[0], 16)
+                lr = int(fields[1], 16)
+            except ValueError:
+                continue
+            samples.append((pc, lr & ~1, fields[2]))
+    return header, samples
+
+
+def main():
+    ap = argparse.ArgumentParser(description='Symbolize a PROF dump')
+    ap.add_argument('-e', '--elf', default='app.axf')
+    ap.add_argument('-m', '--mode', default='flat',
+                    choices=['flat', 'callers', 'folded'])
+    ap.add_argument('-n', '--top', type=int, default=40)
+    ap.add_argument('log', nargs='?')
+    args = ap.parse_args()
+
+    f = open(args.log, errors='replace') if args.log else sys.stdin
+    header, samples = readSamples(f)
+    if header is None or not samples:
+        sys.exit('profsym: no PROF BEGIN/END block found')
+
+    syms = Symbols(args.elf)
+    counts = collections.Counter()
+    for pc, lr, thread in samples:
+        func = syms.lookup(pc)
+        if args.mode == 'flat':
+            counts[func] += 1
+        elif args.mode == 'callers':
+            counts['%s <- %s' % (func, syms.lookup(lr))] += 1
+        else:
+            counts['%s;%s;%s' % (thread, syms.lookup(lr), func)] += 1
+
+    if args.mode == 'folded':
+        for key, n in sorted(counts.items()):
+            print('%s %d' % (key, n))
+        return
+
+    event, period, total, lost = header
+    print('%d samples, event 0x%x every %d, %d lost to ring wrap'
+          % (len(samples), event, period, lost))
+    for key, n in counts.most_common(args.top):
+        print('%6.2f%% %7d  %s' % (100.0 * n / len(samples), n, key))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,102 @@
+/******************************************************************************
+ *
+ * serial.c
+ *
+ * Raw serial port helpers for the host tools
+ *
+ * Copyright (C) 2013 Paul Quevedo
+ *
+ * This program is free software.  It comes without any warranty, to the extent
+ * permitted by applicable law.  You can redistribute it and/or modify it under
+ * the terms of the WTF Public License (WTFPL), Version 2, as published by
+ * Sam Hocevar.  See http://sam.zoy.org/wtfpl/COPYING for more details.
+ *
+ *****************************************************************************/
+#include <fcntl.h>
+#include <stdio.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "serial.h"
+
+static const struct {
+    unsigned long rate;
+    speed_t speed;
+} rate2Speed[] = {
+    {   9600, B9600   },
+    {  19200, B19200  },
+    {  38400, B38400  },
+    {  57600, B57600  },
+    { 115200, B115200 },
+    { 230400, B230400 },
+    { 460800, B460800 },
+    { 921600, B921600 },
+    { 1000000, B1000000 },
+    { 1500000, B1500000 },
+    { 2000000, B2000000 },
+    { 3000000, B3000000 },
+};
+
+static int rateToSpeed(unsigned long rate, speed_t *speed)
+{
+    unsigned i;
+
+    for (i = 0; i < sizeof(rate2Speed) / sizeof(rate2Speed[0]); i++) {
+        if (rate2Speed[i].rate == rate) {
+            *speed = rate2Speed[i].speed;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/*
+ * serialRaw()
+ *
+ * 8N1, no flow control, no line discipline. Works on ttys and ptys.
+ */
+int serialRaw(int fd)
+{
+    struct termios tio;
+
+    if (tcgetattr(fd, &tio) < 0)
+        return -1;
+    cfmakeraw(&tio);
+    tio.c_cflag |=  CLOCAL | CREAD;
+    tio.c_cflag &= ~CRTSCTS;
+    tio.c_cc[VMIN]  = 0;
+    tio.c_cc[VTIME] = 0;
+    return tcsetattr(fd, TCSANOW, &tio);
+}
+
+int serialSetBaud(int fd, unsigned long rate)
+{
+    struct termios tio;
+    speed_t speed;
+
+    /* Odd rates like 1843200 or 3686400 need the termios2 interface */
+    if (rateToSpeed(rate, &speed) < 0)
+        return serialSetCustomBaud(fd, rate);
+
+    if (tcgetattr(fd, &tio) < 0)
+        return -1;
+    cfsetispeed(&tio, speed);
+    cfsetospeed(&tio, speed);
+    return tcsetattr(fd, TCSANOW, &tio);
+}
+
+int serialOpen(const char *dev, unsigned long rate)
+{
+    int fd = open(dev, O_RDWR | O_NOCTTY);
+
+    if (fd < 0) {
+        perror(dev);
+        return -1;
+    }
+    if (serialRaw(fd) < 0 || serialSetBaud(fd, rate) < 0) {
+        close(fd);
+        return -1;
+    }
+    tcflush(fd, TCIOFLUSH);
+    return fd;
+}
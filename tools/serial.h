@@ -0,0 +1,20 @@
+/*******************************************************************************
+ *
+ * serial.h
+ *
+ * Copyright (C) 2013 Paul Quevedo
+ *
+ * This program is free software.  It comes without any warranty, to the extent
+ * permitted by applicable law.  You can redistribute it and/or modify it under
+ * the terms of the WTF Public License (WTFPL), Version 2, as published by
+ * Sam Hocevar.  See http://sam.zoy.org/wtfpl/COPYING for more details.
+ *
+ *******************************************************************************/
+#ifndef __SERIAL_H__
+#define __SERIAL_H__
+
+extern int serialOpen(const char *dev, unsigned long rate);
+extern int serialRaw(int fd);
+extern int serialSetBaud(int fd, unsigned long rate);
+extern int serialSetCustomBaud(int fd, unsigned long rate);
+#endif
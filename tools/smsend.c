@@ -0,0 +1,574 @@
+/******************************************************************************
+ *
+ * smsend.c
+ *
+ * Host side sender for the SMODEM streaming protocol (boot/smodem.c).
+ *
+ *   smsend [-n] [-b baud] [-w window] <device> <file>
+ *       Send file to the bootloader on a serial port. Start it, then reset
+ *       the board. smsend answers the "Press any key" prompt itself and
+ *       follows the bootloader to its transfer rate unless -n is given.
+ *
+ *   smsend -l [-n] [-b baud] [-B rate] [-w window] [-e N] <file>
+ *       Loopback. Runs the bootloader receiver (boot/smodem.c built for the
+ *       host) on the far side of a pty pair and reports throughput. -b paces
+ *       the sender to a line rate so numbers are comparable to a real UART,
+ *       -B has the receiver offer a rate switch like the bootloader does,
+ *       -e corrupts every Nth data frame to exercise selective retransmit.
+ *
+ * Copyright (C) 2013 Paul Quevedo
+ *
+ * This program is free software.  It comes without any warranty, to the extent
+ * permitted by applicable law.  You can redistribute it and/or modify it under
+ * the terms of the WTF Public License (WTFPL), Version 2, as published by
+ * Sam Hocevar.  See http://sam.zoy.org/wtfpl/COPYING for more details.
+ *
+ *****************************************************************************/
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "globalDefs.h"
+#include "crc.h"
+#include "smodem.h"
+#include "serial.h"
+#include "hostuart.h"
+
+#define READY_TIMEOUT_MS 60000
+#define WAKE_PERIOD_MS   200
+#define SWITCH_TIMEOUT_MS 2000
+#define ACK_TIMEOUT_MS   1000
+#define MAX_TIMEOUTS     20
+
+typedef struct {
+    int      fd;
+    const uint8_t *data;
+    uint32_t size;
+    uint32_t numFrames;
+    uint32_t window;
+    uint32_t baud;          /* Line rate, 0 when unknown */
+    uint32_t baseBaud;
+    bool32_t pace;          /* Throttle writes to baud (loopback) */
+    bool32_t wake;          /* Press 's' at the bootloader prompt */
+    bool32_t loop;          /* fd is a pty */
+    bool32_t fixedRate;     /* Ignore rate offers from the receiver */
+    uint32_t corruptEvery;
+    /* Pacing */
+    double   start;
+    uint64_t bytesOut;
+    /* Control frame parser */
+    uint8_t  rxBuf[64];
+    uint32_t rxLen;
+    /* Stats */
+    uint32_t dataSent;
+    uint32_t resent;
+    uint32_t naks;
+    uint32_t timeouts;
+} sender_t;
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int writeAll(sender_t *s, const uint8_t *buf, uint32_t len)
+{
+    while (len) {
+        ssize_t n = write(s->fd, buf, len);
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN)
+                continue;
+            perror("write");
+            return -1;
+        }
+        buf += n;
+        len -= n;
+        s->bytesOut += n;
+    }
+
+    /* 10 bit times per character (8N1) */
+    if (s->pace) {
+        double due = s->start + (double)s->bytesOut * 10 / s->baud;
+        double ahead = due - now();
+        if (ahead > 0)
+            usleep(ahead * 1e6);
+    }
+    return 0;
+}
+
+static int sendFrame(sender_t *s, uint8_t type, uint32_t seq)
+{
+    uint8_t  frame[SMODEM_HDR_SIZE + SMODEM_MAX_PAYLOAD + SMODEM_CRC_SIZE];
+    uint32_t len = 0;
+    uint32_t crc;
+
+    if (type == SMODEM_DATA) {
+        uint32_t offset = seq * SMODEM_MAX_PAYLOAD;
+        len = s->size - offset;
+        if (len > SMODEM_MAX_PAYLOAD)
+            len = SMODEM_MAX_PAYLOAD;
+        memcpy(&frame[SMODEM_HDR_SIZE], s->data + offset, len);
+    }
+
+    frame[0] = SMODEM_SYNC;
+    frame[1] = type;
+    frame[2] = seq & 0xff;
+    frame[3] = (seq >> 8) & 0xff;
+    frame[4] = len & 0xff;
+    frame[5] = len >> 8;
+
+    crc = crc32(0, &frame[1], SMODEM_HDR_SIZE - 1 + len);
+    frame[SMODEM_HDR_SIZE + len + 0] = crc;
+    frame[SMODEM_HDR_SIZE + len + 1] = crc >> 8;
+    frame[SMODEM_HDR_SIZE + len + 2] = crc >> 16;
+    frame[SMODEM_HDR_SIZE + len + 3] = crc >> 24;
+
+    if (type == SMODEM_DATA && s->corruptEvery &&
+                    (++s->dataSent % s->corruptEvery) == 0)
+        frame[SMODEM_HDR_SIZE] ^= 0x5a;
+
+    return writeAll(s, frame, SMODEM_HDR_SIZE + len + SMODEM_CRC_SIZE);
+}
+
+/*
+ * readCtrl()
+ *
+ * Waits up to timeoutMs for a valid control frame from the receiver.
+ * Returns 1 with type/seq (and a READY rate, 0 if none) filled in, 0 on
+ * timeout, -1 on error.
+ */
+static int readCtrl(sender_t *s, int timeoutMs, uint8_t *type, uint16_t *seq,
+                                                uint32_t *rate)
+{
+    double deadline = now() + timeoutMs / 1000.0;
+
+    while (1) {
+        struct pollfd pfd = { .fd = s->fd, .events = POLLIN };
+        int wait;
+        ssize_t n;
+
+        /* Drop anything in front of a sync byte */
+        while (s->rxLen && s->rxBuf[0] != SMODEM_SYNC) {
+            memmove(s->rxBuf, s->rxBuf + 1, --s->rxLen);
+        }
+
+        if (s->rxLen >= SMODEM_HDR_SIZE) {
+            uint8_t *f = s->rxBuf;
+            uint32_t len = f[4] | (f[5] << 8);
+            uint32_t frameLen = SMODEM_HDR_SIZE + len + SMODEM_CRC_SIZE;
+
+            if (len > SMODEM_CTRL_MAX) {
+                memmove(s->rxBuf, s->rxBuf + 1, --s->rxLen);
+                continue;
+            }
+            if (s->rxLen >= frameLen) {
+                uint8_t *c = &f[SMODEM_HDR_SIZE + len];
+                uint32_t crc = c[0] | (c[1] << 8) | (c[2] << 16)
+                                    | ((uint32_t)c[3] << 24);
+
+                if (crc32(0, &f[1], SMODEM_HDR_SIZE - 1 + len) == crc) {
+                    *type = f[1];
+                    *seq  = f[2] | (f[3] << 8);
+                    *rate = 0;
+                    if (len == 4)
+                        *rate = f[6] | (f[7] << 8) | (f[8] << 16)
+                                     | ((uint32_t)f[9] << 24);
+                    s->rxLen -= frameLen;
+                    memmove(s->rxBuf, s->rxBuf + frameLen, s->rxLen);
+                    return 1;
+                }
+                /* Bad frame, resync on the next sync byte */
+                memmove(s->rxBuf, s->rxBuf + 1, --s->rxLen);
+                continue;
+            }
+        }
+
+        wait = (deadline - now()) * 1000;
+        if (wait < 0)
+            return 0;
+        if (poll(&pfd, 1, wait) <= 0)
+            return 0;
+
+        n = read(s->fd, s->rxBuf + s->rxLen, sizeof(s->rxBuf) - s->rxLen);
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN)
+                continue;
+            perror("read");
+            return -1;
+        }
+        if (n == 0) {
+            /* pty hangup, receiver side is gone */
+            usleep(1000);
+            continue;
+        }
+        s->rxLen += n;
+    }
+}
+
+/*
+ * switchRate()
+ *
+ * Accept the receiver's rate offer: echo READY at the current rate, then
+ * move over once it has been sent.
+ */
+static int switchRate(sender_t *s, uint32_t rate)
+{
+    uint8_t frame[SMODEM_HDR_SIZE + SMODEM_CRC_SIZE];
+    uint32_t crc;
+
+    frame[0] = SMODEM_SYNC;
+    frame[1] = SMODEM_READY;
+    frame[2] = frame[3] = frame[4] = frame[5] = 0;
+    crc = crc32(0, &frame[1], SMODEM_HDR_SIZE - 1);
+    frame[6] = crc;
+    frame[7] = crc >> 8;
+    frame[8] = crc >> 16;
+    frame[9] = crc >> 24;
+    if (writeAll(s, frame, sizeof(frame)) < 0)
+        return -1;
+
+    if (!s->loop) {
+        tcdrain(s->fd);
+        if (serialSetBaud(s->fd, rate) < 0)
+            return -1;
+        tcflush(s->fd, TCIFLUSH);
+    }
+    s->rxLen = 0;
+
+    /* Loopback pacing follows the line rate from here on */
+    if (s->pace) {
+        s->start = now();
+        s->bytesOut = 0;
+    }
+    s->baud = rate;
+    fprintf(stderr, "Switched to %u baud\n", rate);
+    return 0;
+}
+
+/* Widen a 16 bit sequence number to the frame closest to base */
+static uint32_t unwrap(uint32_t base, uint16_t seq)
+{
+    return base + (int16_t)(seq - (uint16_t)base);
+}
+
+static int sendFile(sender_t *s)
+{
+    uint32_t base = 0;
+    uint32_t next = 0;
+    uint32_t timeouts = 0;
+    bool32_t eofSent = FALSE;
+    uint32_t rate;
+    uint32_t switchedAt = 0;
+    uint8_t  type;
+    uint16_t seq;
+    int r;
+
+    fprintf(stderr, "Waiting for receiver...\n");
+    for (r = 0; ; r += WAKE_PERIOD_MS) {
+        if (r >= READY_TIMEOUT_MS) {
+            fprintf(stderr, "No READY from receiver\n");
+            return -1;
+        }
+        if (s->wake && !switchedAt && writeAll(s, (const uint8_t *)"s", 1) < 0)
+            return -1;
+        if (readCtrl(s, WAKE_PERIOD_MS, &type, &seq, &rate) <= 0) {
+            /* Receiver not heard at the new rate, go back and ask again */
+            if (switchedAt && r - switchedAt > SWITCH_TIMEOUT_MS) {
+                if (!s->loop && serialSetBaud(s->fd, s->baseBaud) < 0)
+                    return -1;
+                s->baud = s->baseBaud;
+                switchedAt = 0;
+            }
+            continue;
+        }
+        if (type != SMODEM_READY)
+            continue;
+        if (rate && rate != s->baud && !s->fixedRate) {
+            if (switchRate(s, rate) < 0)
+                return -1;
+            switchedAt = r ? r : 1;
+            continue;
+        }
+        break;
+    }
+
+    if (seq && seq < s->window)
+        s->window = seq;
+    fprintf(stderr, "Sending %u bytes, %u frames, window %u\n",
+            s->size, s->numFrames, s->window);
+
+    s->start = now();
+    s->bytesOut = 0;
+
+    while (base < s->numFrames || !eofSent) {
+        while (next < s->numFrames && next - base < s->window) {
+            if (sendFrame(s, SMODEM_DATA, next++) < 0)
+                return -1;
+        }
+        if (next == s->numFrames && !eofSent) {
+            if (sendFrame(s, SMODEM_EOF, s->numFrames) < 0)
+                return -1;
+            eofSent = TRUE;
+        }
+
+        r = readCtrl(s, ACK_TIMEOUT_MS, &type, &seq, &rate);
+        if (r < 0)
+            return -1;
+        if (r == 0) {
+            s->timeouts++;
+            if (++timeouts > MAX_TIMEOUTS) {
+                fprintf(stderr, "Receiver stopped responding\n");
+                return -1;
+            }
+            /* Nudge the receiver with the oldest thing it is missing */
+            if (base < next) {
+                sendFrame(s, SMODEM_DATA, base);
+                s->resent++;
+            }
+            else if (eofSent) {
+                sendFrame(s, SMODEM_EOF, s->numFrames);
+            }
+            continue;
+        }
+        timeouts = 0;
+
+        switch (type) {
+        case SMODEM_ACK: {
+            uint32_t ack = unwrap(base, seq);
+            if (ack > next)
+                break;
+            if (ack > base) {
+                base = ack;
+            }
+            else if (ack == base && base < next) {
+                /* Receiver has nothing of this window, go back */
+                s->resent += next - base;
+                next = base;
+            }
+            if (base == s->numFrames && eofSent)
+                goto done;
+            break;
+        }
+        case SMODEM_NAK: {
+            uint32_t nak = unwrap(base, seq);
+            s->naks++;
+            if (nak >= base && nak < next) {
+                sendFrame(s, SMODEM_DATA, nak);
+                s->resent++;
+            }
+            break;
+        }
+        case SMODEM_READY:
+            if (next && base == 0) {
+                /* Receiver restarted before seeing anything */
+                next = 0;
+                eofSent = FALSE;
+            }
+            break;
+        case SMODEM_CAN:
+            fprintf(stderr, "Transfer cancelled by receiver\n");
+            return -1;
+        default:
+            break;
+        }
+    }
+done:
+    {
+        double secs = now() - s->start;
+        fprintf(stderr, "Sent %u bytes in %.3fs, %.1f KB/s", s->size, secs,
+                s->size / secs / 1024);
+        if (s->baud && (s->pace || !s->loop))
+            fprintf(stderr, ", %.1f%% of line rate",
+                    100.0 * s->size * 10 / s->baud / secs);
+        fprintf(stderr, "\nFrames resent %u, NAKs %u, timeouts %u\n",
+                s->resent, s->naks, s->timeouts);
+    }
+    return 0;
+}
+
+/*
+ * receiver()
+ *
+ * Loopback child. Same receive loop as loadNewImage() in boot.c, minus
+ * the SD card. Exit status 0 only if the data arrived intact.
+ */
+static int receiver(int fd, sender_t *s, uint32_t xferRate)
+{
+    smodemCfg_t cfg = {
+        .uartFd = UART_CONSOLE,
+        .numRetries = 5000,
+        .window = s->window,
+        .baseRate = s->baseBaud,
+        .xferRate = xferRate,
+    };
+    const uint8_t *expect = s->data;
+    uint32_t size = s->size;
+    smodemStats_t stats;
+    uint8_t rxBuffer[SMODEM_MAX_PAYLOAD];
+    uint8_t *out = malloc(size + SMODEM_MAX_PAYLOAD);
+    uint32_t total = 0;
+
+    hostUartAttach(UART_CONSOLE, fd);
+    smodemInit(&cfg);
+
+    while (1) {
+        int len = smodemRecv(rxBuffer, sizeof(rxBuffer));
+        if (len == 0)
+            break;
+        if (len < 0) {
+            fprintf(stderr, "Receiver: error in transfer\n");
+            return 1;
+        }
+        if (total + len > size + SMODEM_MAX_PAYLOAD)
+            return 1;
+        memcpy(out + total, rxBuffer, len);
+        total += len;
+    }
+
+    smodemGetStats(&stats);
+    fprintf(stderr, "Receiver: %u bytes, CRC errors %u, NAKs %u, dups %u\n",
+            total, stats.crcErrors, stats.naks, stats.duplicates);
+
+    if (total != size || memcmp(out, expect, size)) {
+        fprintf(stderr, "Receiver: data MISMATCH\n");
+        return 1;
+    }
+    fprintf(stderr, "Receiver: data OK, crc32 %08x\n", crc32(0, out, size));
+    return 0;
+}
+
+static int loopback(sender_t *s, uint32_t xferRate)
+{
+    int master, slave, status;
+    pid_t pid;
+
+    master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) < 0 || unlockpt(master) < 0) {
+        perror("pty");
+        return -1;
+    }
+    slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+    if (slave < 0 || serialRaw(slave) < 0 || serialRaw(master) < 0) {
+        perror("pty");
+        return -1;
+    }
+
+    pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        return -1;
+    }
+    if (pid == 0) {
+        close(master);
+        _exit(receiver(slave, s, xferRate));
+    }
+    close(slave);
+
+    s->fd = master;
+    if (sendFile(s) < 0) {
+        kill(pid, SIGTERM);
+        waitpid(pid, &status, 0);
+        return -1;
+    }
+    waitpid(pid, &status, 0);
+    return (WIFEXITED(status) && WEXITSTATUS(status) == 0) ? 0 : -1;
+}
+
+static void usage(void)
+{
+    fprintf(stderr,
+        "usage: smsend [-n] [-b baud] [-w window] <device> <file>\n"
+        "       smsend -l [-n] [-b baud] [-B rate] [-w window] [-e N] <file>\n");
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    sender_t s;
+    bool32_t loop = FALSE;
+    unsigned long baud = 0;
+    unsigned long xferRate = 0;
+    const char *dev = NULL;
+    const char *path;
+    struct stat st;
+    uint8_t *data;
+    FILE *fp;
+    int opt;
+    int r;
+
+    memset(&s, 0, sizeof(s));
+    s.window = SMODEM_MAX_WINDOW;
+
+    while ((opt = getopt(argc, argv, "lnb:B:w:e:")) != -1) {
+        switch (opt) {
+        case 'l': loop = TRUE;                      break;
+        case 'n': s.fixedRate = TRUE;               break;
+        case 'B': xferRate = strtoul(optarg, NULL, 0); break;
+        case 'b': baud = strtoul(optarg, NULL, 0);    break;
+        case 'w': s.window = strtoul(optarg, NULL, 0); break;
+        case 'e': s.corruptEvery = strtoul(optarg, NULL, 0); break;
+        default:  usage();
+        }
+    }
+    if (s.window == 0 || s.window > SMODEM_MAX_WINDOW)
+        s.window = SMODEM_MAX_WINDOW;
+
+    if (loop) {
+        if (argc - optind != 1)
+            usage();
+    }
+    else {
+        if (argc - optind != 2)
+            usage();
+        dev = argv[optind++];
+        if (!baud)
+            baud = 115200;
+    }
+    path = argv[optind];
+
+    fp = fopen(path, "rb");
+    if (!fp || fstat(fileno(fp), &st) < 0) {
+        perror(path);
+        return 1;
+    }
+    data = malloc(st.st_size + 1);
+    if (fread(data, 1, st.st_size, fp) != (size_t)st.st_size) {
+        perror(path);
+        return 1;
+    }
+    fclose(fp);
+
+    s.data = data;
+    s.size = st.st_size;
+    s.numFrames = (s.size + SMODEM_MAX_PAYLOAD - 1) / SMODEM_MAX_PAYLOAD;
+    s.baud = baud;
+    s.baseBaud = baud;
+    s.pace = loop && baud;
+    s.loop = loop;
+
+    if (loop) {
+        r = loopback(&s, xferRate);
+    }
+    else {
+        s.fd = serialOpen(dev, baud);
+        if (s.fd < 0)
+            return 1;
+        s.wake = TRUE;
+        r = sendFile(&s);
+        close(s.fd);
+    }
+
+    return r < 0 ? 1 : 0;
+}
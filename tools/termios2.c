@@ -0,0 +1,39 @@
+/******************************************************************************
+ *
+ * termios2.c
+ *
+ * Arbitrary serial rates through the Linux termios2/BOTHER interface. Kept
+ * apart from serial.c as <asm/termbits.h> clashes with <termios.h>.
+ *
+ * Copyright (C) 2013 Paul Quevedo
+ *
+ * This program is free software.  It comes without any warranty, to the extent
+ * permitted by applicable law.  You can redistribute it and/or modify it under
+ * the terms of the WTF Public License (WTFPL), Version 2, as published by
+ * Sam Hocevar.  See http://sam.zoy.org/wtfpl/COPYING for more details.
+ *
+ *****************************************************************************/
+#include <stdio.h>
+#include <sys/ioctl.h>
+#include <asm/termbits.h>
+
+#include "serial.h"
+
+int serialSetCustomBaud(int fd, unsigned long rate)
+{
+    struct termios2 tio;
+
+    if (ioctl(fd, TCGETS2, &tio) < 0) {
+        perror("TCGETS2");
+        return -1;
+    }
+    tio.c_cflag &= ~CBAUD;
+    tio.c_cflag |= BOTHER;
+    tio.c_ispeed = rate;
+    tio.c_ospeed = rate;
+    if (ioctl(fd, TCSETS2, &tio) < 0) {
+        fprintf(stderr, "Unsupported baud rate %lu\n", rate);
+        return -1;
+    }
+    return 0;
+}
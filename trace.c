@@ -0,0 +1,239 @@
+/*******************************************************************************
+ *
+ * trace.c
+ *
+ * Span tracing into a circular buffer of TRACE_RECORDS records, oldest
+ * overwritten first so the buffer always holds the latest few seconds.
+ * There is one core, so one buffer, and a record is claimed and filled with
+ * IRQs masked: about 20 cycles a record.
+ *
+ * Exported as Chrome trace-event JSON. Each thread gets its own track and
+ * ISRs share an "irq" track. Timestamps are the cycle counter unwrapped
+ * record to record, so gaps of more than one counter wrap (~6s) without a
+ * record come out short. The systick ISR records every 1ms, so this doesn't
+ * happen in practice.
+ *
+ *   SDHC commands, block reads/writes, f_read()/f_write() and every ISR
+ *   call (_irq_eh goes through traceIsrDispatch()) are traced out of the
+ *   box.
+ *
+ * Copyright (C) 2013 Paul Quevedo
+ *
+ * This program is free software.  It comes without any warranty, to the extent
+ * permitted by applicable law.  You can redistribute it and/or modify it under
+ * the terms of the WTF Public License (WTFPL), Version 2, as published by
+ * Sam Hocevar.  See http://sam.zoy.org/wtfpl/COPYING for more details.
+ *
+ *******************************************************************************/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "arm/asm.h"
+#include "arm/perfmon.h"
+
+#include "ch.h"
+#include "ff.h"
+
+#include "globalDefs.h"
+#include "hardware.h"
+#include "trace.h"
+
+#define TRACE_LINE_SIZE 160
+#define TRACE_TID_IRQ   0
+#define TRACE_TID_BOOT  1   /* Before the kernel was up */
+
+#define CYCLES_PER_US   (MPU_CLKOUT / 1000000)
+
+extern void (*isrVectorTable[NUM_IRQS])(void);
+
+static traceRecord_t traceBuf[TRACE_RECORDS];
+static uint32_t traceHead;
+static volatile bool32_t traceOn = TRUE;
+
+/*
+ * traceRecord()
+ *
+ * Use TRACE_BEGIN()/TRACE_END()
+ */
+void traceRecord(uint32_t id, uint32_t phase)
+{
+    traceRecord_t *rec;
+    uint32_t flags;
+
+    if (!traceOn)
+        return;
+
+    _irq_save(flags);
+    rec = &traceBuf[traceHead & (TRACE_RECORDS - 1)];
+    traceHead++;
+    rec->timestamp = _perfmon_ccnt();
+    rec->id        = id;
+    rec->phase     = phase;
+    rec->isr       = hwInIsr();
+    rec->thread    = currp;
+    _irq_restore(flags);
+}
+
+/*
+ * traceIsrDispatch()
+ *
+ * _irq_eh calls this instead of the ISR when tracing, same arguments plus
+ * the IRQ number
+ */
+void traceIsrDispatch(uint32_t *frame, uint32_t lr, uint32_t irq)
+{
+    void (*isr)(uint32_t *, uint32_t) =
+        (void (*)(uint32_t *, uint32_t))isrVectorTable[irq];
+
+    TRACE_BEGIN(TRACE_ID_IRQ + irq);
+    isr(frame, lr);
+    TRACE_END(TRACE_ID_IRQ + irq);
+}
+
+void traceStart(void)
+{
+    traceOn = TRUE;
+}
+
+void traceStop(void)
+{
+    traceOn = FALSE;
+}
+
+/****************************
+ * Export
+ ****************************/
+typedef void (*traceOutput_t)(void *arg, const char *line, int len);
+
+static int traceIdName(char *buf, int size, uint32_t id)
+{
+    if (id < TRACE_ID_IRQ + NUM_IRQS)
+        return sniprintf(buf, size, "irq%lu", id - TRACE_ID_IRQ);
+    if (id >= TRACE_ID_SDHC_CMD && id < TRACE_ID_SDHC_CMD + 64)
+        return sniprintf(buf, size, "CMD%lu", id - TRACE_ID_SDHC_CMD);
+
+    switch (id) {
+    case TRACE_ID_SDHC_READ:  return sniprintf(buf, size, "sdhcReadBlock");
+    case TRACE_ID_SDHC_WRITE: return sniprintf(buf, size, "sdhcWriteBlock");
+    case TRACE_ID_F_READ:     return sniprintf(buf, size, "f_read");
+    case TRACE_ID_F_WRITE:    return sniprintf(buf, size, "f_write");
+    }
+    return sniprintf(buf, size, "id%lu", id);
+}
+
+static void traceExport(traceOutput_t out, void *arg)
+{
+    char line[TRACE_LINE_SIZE];
+    char name[16];
+    bool32_t wasOn = traceOn;
+    uint32_t first;
+    uint32_t last;
+    uint32_t prev;
+    uint64_t cycles = 0;
+    Thread *tp;
+    int len;
+
+    traceOn = FALSE;    /* Freeze the buffer, f_write() would trace itself */
+
+    last  = traceHead;
+    first = (last > TRACE_RECORDS) ? last - TRACE_RECORDS : 0;
+    prev  = (first != last) ? traceBuf[first & (TRACE_RECORDS - 1)].timestamp
+                            : 0;
+
+    len = sniprintf(line, sizeof(line), "{\"traceEvents\":[\n");
+    out(arg, line, len);
+
+    /* Track names */
+    len = sniprintf(line, sizeof(line),
+                    "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,"
+                    "\"tid\":%d,\"args\":{\"name\":\"irq\"}},\n"
+                    "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,"
+                    "\"tid\":%d,\"args\":{\"name\":\"boot\"}}",
+                    TRACE_TID_IRQ, TRACE_TID_BOOT);
+    out(arg, line, len);
+    for (tp = chRegFirstThread(); tp != NULL; tp = chRegNextThread(tp)) {
+        len = sniprintf(line, sizeof(line),
+                        ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,"
+                        "\"tid\":%lu,\"args\":{\"name\":\"%s\"}}",
+                        (uint32_t)tp, tp->p_name ? tp->p_name : "?");
+        out(arg, line, len);
+    }
+
+    for (; first != last; first++) {
+        traceRecord_t *rec = &traceBuf[first & (TRACE_RECORDS - 1)];
+        uint32_t tid;
+        uint32_t us;
+        uint32_t ns;
+
+        cycles += rec->timestamp - prev;
+        prev    = rec->timestamp;
+        us = (uint32_t)(cycles / CYCLES_PER_US);
+        ns = (uint32_t)(cycles % CYCLES_PER_US) * 1000 / CYCLES_PER_US;
+
+        if (rec->isr)
+            tid = TRACE_TID_IRQ;
+        else if (rec->thread == NULL)
+            tid = TRACE_TID_BOOT;
+        else
+            tid = (uint32_t)rec->thread;
+
+        traceIdName(name, sizeof(name), rec->id);
+        len = sniprintf(line, sizeof(line),
+                        ",\n{\"name\":\"%s\",\"ph\":\"%s\",\"ts\":%lu.%03lu,"
+                        "\"pid\":0,\"tid\":%lu}",
+                        name,
+                        (rec->phase == TRACE_PHASE_BEGIN) ? "B" : "E",
+                        us, ns, tid);
+        out(arg, line, len);
+    }
+
+    len = sniprintf(line, sizeof(line), "\n]}\n");
+    out(arg, line, len);
+
+    traceOn = wasOn;
+}
+
+static void traceConsoleOut(void *arg, const char *line, int len)
+{
+    uartWrite(UART_CONSOLE, (uint8_t *)line, len);
+}
+
+static void traceFileOut(void *arg, const char *line, int len)
+{
+    UINT written;
+
+    f_write((FIL *)arg, line, len, &written);
+}
+
+/*
+ * traceDump()
+ *
+ * Writes the buffer to the console, copy from {"traceEvents" to ]} into
+ * a .json file
+ */
+void traceDump(void)
+{
+    traceExport(traceConsoleOut, NULL);
+}
+
+/*
+ * traceSave()
+ *
+ * Writes the buffer to a file on a mounted volume
+ *
+ * RETURNS: OK, or ERROR if the file can't be created
+ */
+int traceSave(const char *path)
+{
+    static FIL fp;
+
+    if (f_open(&fp, path, FA_WRITE | FA_CREATE_ALWAYS) != FR_OK)
+        return ERROR;
+
+    traceExport(traceFileOut, &fp);
+
+    if (f_close(&fp) != FR_OK)
+        return ERROR;
+
+    return OK;
+}
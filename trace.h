@@ -0,0 +1,64 @@
+/*******************************************************************************
+ *
+ * trace.h
+ *
+ * Span tracing. TRACE_BEGIN(id)/TRACE_END(id) each append a 12 byte cycle
+ * counter stamped record to a circular buffer, traceDump()/traceSave() write
+ * the buffer out as Chrome trace-event JSON (chrome://tracing, Perfetto).
+ * See trace.c.
+ *
+ * Built with make TRACE=1, otherwise the macros compile to nothing and
+ * trace.c isn't linked.
+ *
+ * Copyright (C) 2013 Paul Quevedo
+ *
+ * This program is free software.  It comes without any warranty, to the extent
+ * permitted by applicable law.  You can redistribute it and/or modify it under
+ * the terms of the WTF Public License (WTFPL), Version 2, as published by
+ * Sam Hocevar.  See http://sam.zoy.org/wtfpl/COPYING for more details.
+ *
+ *******************************************************************************/
+#ifndef __TRACE_H__
+#define __TRACE_H__
+#include "globalDefs.h"
+
+#define TRACE_RECORDS 8192  /* Power of 2 */
+
+enum {
+    TRACE_ID_IRQ        = 0x000,    /* + IRQ number, every ISR call */
+    TRACE_ID_SDHC_CMD   = 0x100,    /* + command index */
+    TRACE_ID_SDHC_READ  = 0x140,
+    TRACE_ID_SDHC_WRITE,
+    TRACE_ID_F_READ,
+    TRACE_ID_F_WRITE,
+
+    TRACE_ID_USER       = 0x200,    /* Shown as "id<n>" */
+};
+
+enum {
+    TRACE_PHASE_BEGIN,
+    TRACE_PHASE_END,
+};
+
+typedef struct {
+    uint32_t    timestamp;  /* Cycle counter */
+    uint16_t    id;
+    uint8_t     phase;
+    uint8_t     isr;        /* Recorded by an ISR, thread is who it interrupted */
+    const void *thread;
+} traceRecord_t;
+
+#if TRACE_ENABLE
+#define TRACE_BEGIN(id) traceRecord((id), TRACE_PHASE_BEGIN)
+#define TRACE_END(id)   traceRecord((id), TRACE_PHASE_END)
+
+extern void traceRecord(uint32_t id, uint32_t phase);
+extern void traceStart (void);
+extern void traceStop  (void);
+extern void traceDump  (void);
+extern int  traceSave  (const char *path);
+#else
+#define TRACE_BEGIN(id)
+#define TRACE_END(id)
+#endif
+#endif
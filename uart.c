@@ -16,6 +16,12 @@
 #include "am335x.h"
 #include "hardware.h"
 
+#if USE_CHIBIOS
+#include <string.h>
+#include "arm/asm.h"
+#include "ch.h"
+#endif
+
 #define CLK_INPUT_FREQ (PER_CLKOUTM2 / 4)
 
 static const uint32_t inst2Base[] = {
@@ -28,27 +34,461 @@ static const uint32_t inst2Base[] = {
 };
 
 static bool32_t uartInitialized[MAX_UARTS];
-
-/* Divided from 48MHz CLK_INPUT_FREQ */
-static const uint16_t baud2Div[] = {
-    [BAUD_300]    = 10000,
-    [BAUD_600]    = 5000,
-    [BAUD_1200]   = 2500,
-    [BAUD_2400]   = 1250,
-    [BAUD_4800]   = 625,
-    [BAUD_9600]   = 313,
-    [BAUD_14400]  = 208,
-    [BAUD_19200]  = 156,
-    [BAUD_28800]  = 104,
-    [BAUD_38400]  = 78,
-    [BAUD_57600]  = 52,
-    [BAUD_115200] = 26,
-    [BAUD_230400] = 13,
+static uint32_t uartMode[MAX_UARTS];
+
+static const uint32_t baud2Rate[] = {
+    [BAUD_300]     = 300,
+    [BAUD_600]     = 600,
+    [BAUD_1200]    = 1200,
+    [BAUD_2400]    = 2400,
+    [BAUD_4800]    = 4800,
+    [BAUD_9600]    = 9600,
+    [BAUD_14400]   = 14400,
+    [BAUD_19200]   = 19200,
+    [BAUD_28800]   = 28800,
+    [BAUD_38400]   = 38400,
+    [BAUD_57600]   = 57600,
+    [BAUD_115200]  = 115200,
+    [BAUD_230400]  = 230400,
+    [BAUD_460800]  = 460800,
+    [BAUD_921600]  = 921600,
+    [BAUD_1843200] = 1843200,
+    [BAUD_3000000] = 3000000,
+    [BAUD_3686400] = 3686400,
 };
 
+#define UART_MAX_DIVISOR 0x3FFF
+
 static const uint32_t REG_CONFIG_MODE_A = 0x0080;
 static const uint32_t REG_CONFIG_MODE_B = 0x00BF;
 
+#if USE_CHIBIOS
+/****************************
+ * Interrupt driven mode
+ ****************************/
+#define UART_TX_RING_SIZE  1024 /* Powers of 2 */
+#define UART_RX_RING_SIZE  256
+#define UART_RX_TIMEOUT_MS 2    /* Gap that ends a uartRead() */
+
+/* Single producer, single consumer. head is only written by the producer
+ * and tail only by the consumer so neither side needs a lock. Indices run
+ * free, head - tail is the fill level. */
+typedef struct {
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    uint32_t mask;
+    uint8_t *buf;
+} uartRing_t;
+
+typedef struct {
+    uartRing_t      tx;         /* Threads produce, ISR consumes */
+    uartRing_t      rx;         /* ISR produces, reader consumes */
+    BinarySemaphore txSpace;    /* Signalled as the ISR drains tx */
+    BinarySemaphore rxData;     /* Signalled as the ISR fills rx */
+    Mutex           txLock;     /* Keeps writers from interleaving */
+    uint32_t        ier;        /* IER shadow, changed with irqs off */
+    uint32_t        rxOverruns; /* Bytes dropped on a full rx ring */
+    uint8_t         txBuf[UART_TX_RING_SIZE];
+    uint8_t         rxBuf[UART_RX_RING_SIZE];
+} uartIrqState_t;
+
+static uartIrqState_t uartIrq[MAX_UARTS];
+
+static uint32_t ringPut(uartRing_t *ring, const uint8_t *data, uint32_t len)
+{
+    uint32_t head = ring->head;
+    uint32_t n;
+
+    for (n = 0; n < len && (head - ring->tail) <= ring->mask; n++)
+        ring->buf[head++ & ring->mask] = data[n];
+
+    _dmb(); /* Data lands before the consumer can see it */
+    ring->head = head;
+
+    return n;
+}
+
+static uint32_t ringGet(uartRing_t *ring, uint8_t *data, uint32_t len)
+{
+    uint32_t tail = ring->tail;
+    uint32_t n;
+
+    for (n = 0; n < len && tail != ring->head; n++)
+        data[n] = ring->buf[tail++ & ring->mask];
+
+    _dmb(); /* Data is read before the producer can reuse the slot */
+    ring->tail = tail;
+
+    return n;
+}
+
+/*
+ * uartIrqService()
+ *
+ * Empties the RX FIFO into the rx ring, which also clears the RHR, RX
+ * timeout and line status interrupts, then tops the TX FIFO back up from
+ * the tx ring. THR interrupts stay on only while there is data to send.
+ */
+static void uartIrqService(uint32_t inst)
+{
+    uint32_t base = inst2Base[inst];
+    uartIrqState_t *state = &uartIrq[inst];
+    uartRing_t *rx = &state->rx;
+    uartRing_t *tx = &state->tx;
+    uint32_t head = rx->head;
+    uint32_t tail = tx->tail;
+    bool32_t rxWake = FALSE;
+    bool32_t txWake = FALSE;
+
+    while (UART_LSR(base) & UART_LSR_RXFIFOE) {
+        uint8_t c = UART_RHR(base);
+
+        if ((head - rx->tail) > rx->mask)
+            state->rxOverruns++;
+        else
+            rx->buf[head++ & rx->mask] = c;
+    }
+    if (head != rx->head) {
+        _dmb();
+        rx->head = head;
+        rxWake = TRUE;
+    }
+
+    if (state->ier & UART_IER_THR_IT) {
+        while (tail != tx->head && !(UART_SSR(base) & UART_SSR_TXFIFOFULL))
+            UART_THR(base) = tx->buf[tail++ & tx->mask];
+
+        if (tail != tx->tail) {
+            _dmb();
+            tx->tail = tail;
+            txWake = TRUE;
+        }
+        if (tail == tx->head) {
+            state->ier &= ~UART_IER_THR_IT;
+            UART_IER(base) = state->ier;
+        }
+    }
+
+    if (rxWake || txWake) {
+        chSysLockFromIsr();
+        if (rxWake)
+            chBSemSignalI(&state->rxData);
+        if (txWake)
+            chBSemSignalI(&state->txSpace);
+        chSysUnlockFromIsr();
+    }
+}
+
+static void uart0ISR(void) { uartIrqService(UART_0); }
+static void uart1ISR(void) { uartIrqService(UART_1); }
+static void uart2ISR(void) { uartIrqService(UART_2); }
+static void uart3ISR(void) { uartIrqService(UART_3); }
+static void uart4ISR(void) { uartIrqService(UART_4); }
+static void uart5ISR(void) { uartIrqService(UART_5); }
+
+static const struct {
+    uint32_t irqNum;
+    void (*isr)(void);
+} inst2Irq[] = {
+    [UART_0] = { IRQ_UART0INT, uart0ISR },
+    [UART_1] = { IRQ_UART1INT, uart1ISR },
+    [UART_2] = { IRQ_UART2INT, uart2ISR },
+    [UART_3] = { IRQ_UART3INT, uart3ISR },
+    [UART_4] = { IRQ_UART4INT, uart4ISR },
+    [UART_5] = { IRQ_UART5INT, uart5ISR },
+};
+
+static void uartIrqInit(uint32_t inst)
+{
+    uartIrqState_t *state = &uartIrq[inst];
+
+    state->tx.head = state->tx.tail = 0;
+    state->tx.mask = UART_TX_RING_SIZE - 1;
+    state->tx.buf  = state->txBuf;
+    state->rx.head = state->rx.tail = 0;
+    state->rx.mask = UART_RX_RING_SIZE - 1;
+    state->rx.buf  = state->rxBuf;
+    state->rxOverruns = 0;
+
+    chBSemInit(&state->txSpace, TRUE);
+    chBSemInit(&state->rxData,  TRUE);
+    chMtxInit(&state->txLock);
+
+    state->ier = UART_IER_RHR_IT | UART_IER_LINE_STS_IT;
+    UART_IER(inst2Base[inst]) = state->ier;
+
+    hwInstallIRQ(inst2Irq[inst].irqNum, inst2Irq[inst].isr,
+                 INT_PRIORITY_DEFAULT);
+}
+
+/* uartBaudConfig() leaves IER cleared, put back what the ISR expects */
+static void uartIrqRestore(uint32_t inst)
+{
+    chSysLock();
+    UART_IER(inst2Base[inst]) = uartIrq[inst].ier;
+    chSysUnlock();
+}
+
+static int uartIrqWrite(uint32_t inst, const uint8_t *data, uint32_t len)
+{
+    uartIrqState_t *state = &uartIrq[inst];
+    uint32_t txLen = 0;
+
+    chMtxLock(&state->txLock);
+    while (txLen < len) {
+        uint32_t n = ringPut(&state->tx, data + txLen, len - txLen);
+
+        if (n) {
+            txLen += n;
+            chSysLock();
+            state->ier |= UART_IER_THR_IT;
+            UART_IER(inst2Base[inst]) = state->ier;
+            chSysUnlock();
+        }
+        /* Ring full, sleep until the ISR has made room */
+        if (txLen < len)
+            chBSemWait(&state->txSpace);
+    }
+    chMtxUnlock();
+
+    return txLen;
+}
+
+static int uartIrqRead(uint32_t inst, uint8_t *data, uint32_t len)
+{
+    uartIrqState_t *state = &uartIrq[inst];
+    uint32_t rxLen = 0;
+
+    while (rxLen < len) {
+        rxLen += ringGet(&state->rx, data + rxLen, len - rxLen);
+        if (rxLen == len)
+            break;
+
+        if (chBSemWaitTimeout(&state->rxData,
+                              MS2ST(UART_RX_TIMEOUT_MS)) == RDY_TIMEOUT) {
+            rxLen += ringGet(&state->rx, data + rxLen, len - rxLen);
+            break;
+        }
+    }
+
+    return rxLen;
+}
+
+/****************************
+ * EDMA mode
+ ****************************/
+#define UART_DMA_RX_SIZE 4096   /* Power of 2, ~11ms at 3686400 */
+
+typedef struct {
+    uint32_t        txChan;
+    uint32_t        rxChan;
+    BinarySemaphore txDone;     /* Signalled from the EDMA completion */
+    Mutex           txLock;
+    volatile uint32_t rxWraps;  /* Laps of rxBuf, from the EDMA completion */
+    uint32_t        rxCount;    /* Bytes consumed, runs free */
+    uint32_t        rxOverruns; /* Bytes lost to the EDMA lapping a reader */
+    uint8_t        *rxBuf;      /* Uncached, read straight out of */
+} uartDmaState_t;
+
+static uartDmaState_t uartDma[UART_2 + 1];
+static uint8_t uartDmaRxBuf[UART_2 + 1][UART_DMA_RX_SIZE] DMA_BSS;
+
+static const struct {
+    uint32_t tx;
+    uint32_t rx;
+} inst2Evt[] = {
+    [UART_0] = { EDMA_EVT_UART0_TX, EDMA_EVT_UART0_RX },
+    [UART_1] = { EDMA_EVT_UART1_TX, EDMA_EVT_UART1_RX },
+    [UART_2] = { EDMA_EVT_UART2_TX, EDMA_EVT_UART2_RX },
+};
+
+static void uartDmaTxDone(uint32_t chan, void *arg)
+{
+    uartDmaState_t *state = arg;
+
+    edmaDisable(chan);
+
+    chSysLockFromIsr();
+    chBSemSignalI(&state->txDone);
+    chSysUnlockFromIsr();
+}
+
+static void uartDmaRxWrap(uint32_t chan, void *arg)
+{
+    uartDmaState_t *state = arg;
+
+    state->rxWraps++;
+}
+
+/*
+ * uartDmaInit()
+ *
+ * TX channel is armed per uartWrite(). RX runs for good, one byte per
+ * request round rxBuf, with a linked copy of its PaRAM set reloading it
+ * each time it wraps. Readers chase the set's destination address, the
+ * completion interrupt at each wrap counts the laps.
+ */
+static int uartDmaInit(uint32_t inst)
+{
+    uint32_t base = inst2Base[inst];
+    uartDmaState_t *state;
+    edmaParam_t rx;
+    int link;
+
+    if (inst >= ARRAY_SIZE(uartDma))
+        return ERROR;
+
+    if (edmaInit() != OK || (link = edmaParamAlloc()) == ERROR)
+        return ERROR;
+
+    state = &uartDma[inst];
+    state->txChan = inst2Evt[inst].tx;
+    state->rxChan = inst2Evt[inst].rx;
+    state->rxWraps    = 0;
+    state->rxCount    = 0;
+    state->rxOverruns = 0;
+    state->rxBuf      = uartDmaRxBuf[inst];
+    chBSemInit(&state->txDone, TRUE);
+    chMtxInit(&state->txLock);
+
+    edmaChannelConfig(state->txChan, uartDmaTxDone, state);
+    edmaChannelConfig(state->rxChan, uartDmaRxWrap, state);
+
+    memset(&rx, 0, sizeof(rx));
+    rx.opt        = EDMA_OPT_TCC(state->rxChan) /* A-sync, irq per lap */
+                  | EDMA_OPT_TCINTEN;
+    rx.src        = (uint32_t)&UART_RHR(base);
+    rx.dst        = (uint32_t)state->rxBuf;
+    rx.aCnt       = 1;
+    rx.bCnt       = UART_DMA_RX_SIZE;
+    rx.cCnt       = 1;
+    rx.dstBIdx    = 1;
+    rx.link       = EDMA_LINK(link);
+    rx.bCntReload = UART_DMA_RX_SIZE;
+    edmaParamSet(link, &rx);
+    edmaParamSet(state->rxChan, &rx);
+
+    edmaEnable(state->rxChan);
+
+    return OK;
+}
+
+static int uartDmaWrite(uint32_t inst, const uint8_t *data, uint32_t len)
+{
+    uint32_t base = inst2Base[inst];
+    uartDmaState_t *state = &uartDma[inst];
+    uint32_t txLen = 0;
+
+    chMtxLock(&state->txLock);
+    edmaCacheClean(data, len);
+
+    while (txLen < len) {
+        uint32_t n = len - txLen;
+        edmaParam_t tx;
+
+        LIMIT_HI_VAL(n, EDMA_MAX_COUNT);
+        memset(&tx, 0, sizeof(tx));
+        tx.opt     = EDMA_OPT_TCC(state->txChan) | EDMA_OPT_TCINTEN;
+        tx.src     = (uint32_t)(data + txLen);
+        tx.dst     = (uint32_t)&UART_THR(base);
+        tx.aCnt    = 1;
+        tx.bCnt    = n;
+        tx.cCnt    = 1;
+        tx.srcBIdx = 1;
+        tx.link    = EDMA_NULL_LINK;
+
+        edmaParamSet(state->txChan, &tx);
+
+        /* The UART only raises a fresh request after a THR write. If the
+         * FIFO has room and none is latched from the last job, the edge
+         * is gone and the first byte has to be kicked off by hand. */
+        if (!edmaPending(state->txChan) &&
+            !(UART_SSR(base) & UART_SSR_TXFIFOFULL))
+            edmaTrigger(state->txChan);
+        edmaEnable(state->txChan);
+
+        chBSemWait(&state->txDone);
+        txLen += n;
+    }
+    chMtxUnlock();
+
+    return txLen;
+}
+
+/*
+ * uartDmaRxHead()
+ *
+ * RETURNS: bytes received since uartDmaInit(), running free like rxCount
+ */
+static uint32_t uartDmaRxHead(uartDmaState_t *state)
+{
+    uint32_t wraps;
+    uint32_t head;
+
+    do {
+        wraps = state->rxWraps;
+        head  = EDMA_PARAM_DST(state->rxChan) - (uint32_t)state->rxBuf;
+    } while (wraps != state->rxWraps);
+
+    /* Caught between the last byte and the link reload */
+    if (head >= UART_DMA_RX_SIZE)
+        head = 0;
+    head += wraps * UART_DMA_RX_SIZE;
+
+    /* Wrapped, but the completion interrupt hasn't counted it yet */
+    if ((int32_t)(head - state->rxCount) < 0)
+        head += UART_DMA_RX_SIZE;
+
+    return head;
+}
+
+static int uartDmaRead(uint32_t inst, uint8_t *data, uint32_t len)
+{
+    uartDmaState_t *state = &uartDma[inst];
+    uint32_t rxLen = 0;
+    uint32_t idleMs = 0;
+
+    while (rxLen < len) {
+        uint32_t head = uartDmaRxHead(state);
+        uint32_t tail;
+        uint32_t n;
+
+        if (head == state->rxCount) {
+            if (idleMs++ >= UART_RX_TIMEOUT_MS)
+                break;
+            chThdSleepMilliseconds(1);
+            continue;
+        }
+
+        /* Lapped, whatever is left of the unread bytes has been
+         * written over. Drop it all and carry on from the EDMA. */
+        if (head - state->rxCount > UART_DMA_RX_SIZE) {
+            state->rxOverruns += head - state->rxCount;
+            state->rxCount = head;
+            continue;
+        }
+
+        /* Contiguous run up to head or the end of the buffer */
+        tail = state->rxCount & (UART_DMA_RX_SIZE - 1);
+        n = head - state->rxCount;
+        LIMIT_HI_VAL(n, UART_DMA_RX_SIZE - tail);
+        LIMIT_HI_VAL(n, len - rxLen);
+
+        memcpy(data + rxLen, &state->rxBuf[tail], n);
+
+        /* Lapped during the copy, those bytes can't be trusted either */
+        if (uartDmaRxHead(state) - state->rxCount > UART_DMA_RX_SIZE)
+            continue;
+
+        rxLen += n;
+        state->rxCount += n;
+        idleMs = 0;
+    }
+
+    return rxLen;
+}
+#endif
+
 /*
  * uartFifoConfig()
  *
@@ -76,6 +516,12 @@ static void uartFifoConfig(uint32_t base, uartCfg_t *cfg)
         scrValue |= UART_SCR_TX_TRIG_GRANU1;
     }
 
+    if (cfg->mode == UART_MODE_DMA) {
+        /* DMA mode 1, both TX and RX requests */
+        scrValue |= UART_SCR_DMAMODECTL;
+        scrValue |= 1 << UART_SCR_DMAMODE2_SHFT;
+    }
+
     /* 1. Switch to configuration mode B to access EFR*/
     lcrValue = UART_LCR(base);
     UART_LCR(base) = REG_CONFIG_MODE_B;
@@ -116,15 +562,66 @@ static void uartFifoConfig(uint32_t base, uartCfg_t *cfg)
     UART_LCR(base) = lcrValue;
 }
 
+/*
+ * uartBaudCalc()
+ *
+ * Works out the divisor for rate in both 16x and 13x oversampling and keeps
+ * whichever lands closer, 16x on a tie. 13x is what makes the rates above
+ * 230400 usable off the 48MHz functional clock, e.g. 921600 is 7% out in 16x
+ * but 0.16% in 13x. baud is filled in even when the error is too large.
+ *
+ * RETURNS: OK, or ERROR if the best error exceeds UART_BAUD_MAX_ERROR_PPM
+ */
+int uartBaudCalc(uint32_t rate, uartBaud_t *baud)
+{
+    static const struct {
+        uint32_t mode;
+        uint32_t overSample;
+    } modes[] = {
+        { UART_MDR1_MODE_16X, 16 },
+        { UART_MDR1_MODE_13X, 13 },
+    };
+    int32_t bestError = 0x7FFFFFFF;
+    int i;
+
+    if (rate == 0)
+        return ERROR;
+
+    for (i = 0; i < ARRAY_SIZE(modes); i++) {
+        uint32_t step = modes[i].overSample * rate;
+        uint32_t divisor = (CLK_INPUT_FREQ + step / 2) / step;
+        uint32_t actual;
+        int32_t  error;
+
+        LIMIT_VAL(divisor, 1, UART_MAX_DIVISOR);
+        actual = CLK_INPUT_FREQ / (modes[i].overSample * divisor);
+        error  = ((long long)actual - rate) * 1000000 / rate;
+
+        if ((error < 0 ? -error : error) < bestError) {
+            bestError      = error < 0 ? -error : error;
+            baud->mode     = modes[i].mode;
+            baud->divisor  = divisor;
+            baud->actual   = actual;
+            baud->errorPpm = error;
+        }
+    }
+
+    return (bestError > UART_BAUD_MAX_ERROR_PPM) ? ERROR : OK;
+}
+
+uint32_t uartBaudRate(uint32_t baud)
+{
+    return (baud < MAX_BAUDS) ? baud2Rate[baud] : 0;
+}
+
 /*
  * uartBaudConfig()
  *
  * Ridiclous steps to set baud rate and line control.
  * s19.4.1.1.3 of am355x_TRM
  */
-static void uartBaudConfig(uint32_t base, uartCfg_t *cfg)
+static void uartBaudConfig(uint32_t base, const uartBaud_t *baud)
 {
-    uint32_t baudDiv = baud2Div[cfg->baud];
     uint32_t efrValue;
 
     UART_MDR1(base) = UART_MDR1_MODESELECT(UART_MDR1_MODE_DISABLE);
@@ -138,8 +635,8 @@ static void uartBaudConfig(uint32_t base, uartCfg_t *cfg)
     UART_LCR(base) = REG_CONFIG_MODE_B;
 
     /* Set Baud Divisors */
-    UART_DLL(base) = UART_DLL_CLOCK_LSB(baudDiv);
-    UART_DLH(base) = UART_DLH_CLOCK_MSB(baudDiv);
+    UART_DLL(base) = UART_DLL_CLOCK_LSB(baud->divisor);
+    UART_DLH(base) = UART_DLH_CLOCK_MSB(baud->divisor);
 
     /* Crap to access IER */
     UART_LCR(base) = 0x0;
@@ -154,14 +651,17 @@ static void uartBaudConfig(uint32_t base, uartCfg_t *cfg)
     /* 8-bit words, no parity, 1 stop bit */
     UART_LCR(base)  = UART_LCR_CHAR_LENGTH(0x3);
 
-    UART_MDR1(base) = UART_MDR1_MODESELECT(UART_MDR1_MODE_16X);
+    UART_MDR1(base) = UART_MDR1_MODESELECT(baud->mode);
 }
 
 int uartConfig(uint32_t inst, uartCfg_t *cfg)
 {
     uint32_t base = inst2Base[inst];
+    uartCfg_t fifoCfg = *cfg;
+    uartBaud_t baud;
 
-    LIMIT_HI_VAL(cfg->baud, BAUD_230400);
+    if (uartBaudCalc(uartBaudRate(cfg->baud), &baud) != OK)
+        return ERROR;
 
     /* Enable UART Clock */
     switch (inst) {
@@ -191,14 +691,87 @@ int uartConfig(uint32_t inst, uartCfg_t *cfg)
         return ERROR;
     }
 
-    uartFifoConfig(base, cfg);
-    uartBaudConfig(base, cfg);
+    /* A DMA request per byte, any more and bytes get stranded */
+    if (cfg->mode == UART_MODE_DMA) {
+        fifoCfg.fifo.enable = TRUE;
+        fifoCfg.fifo.rxTrig = 1;
+        fifoCfg.fifo.txTrig = 1;
+    }
 
+    uartFifoConfig(base, &fifoCfg);
+    uartBaudConfig(base, &baud);
+
+    switch (cfg->mode) {
+    case UART_MODE_POLLED:
+        break;
+#if USE_CHIBIOS
+    case UART_MODE_IRQ:
+        uartIrqInit(inst);
+        break;
+    case UART_MODE_DMA:
+        if (uartDmaInit(inst) != OK)
+            return ERROR;
+        break;
+#endif
+    default:
+        return ERROR;
+    }
+
+    uartMode[inst]        = cfg->mode;
     uartInitialized[inst] = TRUE;
 
     return OK;
 }
 
+/*
+ * uartSetRate()
+ *
+ * Changes the line rate of a configured uart to any rate uartBaudCalc()
+ * accepts. Anything still in the TX FIFO goes out at the old rate first.
+ */
+int uartSetRate(uint32_t inst, uint32_t rate)
+{
+    uartBaud_t baud;
+
+    if (!uartInitialized[inst])
+        return ERROR;
+
+    if (uartBaudCalc(rate, &baud) != OK)
+        return ERROR;
+
+    uartDrain(inst);
+    uartBaudConfig(inst2Base[inst], &baud);
+
+#if USE_CHIBIOS
+    if (uartMode[inst] == UART_MODE_IRQ)
+        uartIrqRestore(inst);
+#endif
+
+    return OK;
+}
+
+/*
+ * uartDrain()
+ *
+ * Waits until the tx ring, TX FIFO and shift register are empty
+ */
+void uartDrain(uint32_t inst)
+{
+    uint32_t base = inst2Base[inst];
+
+    if (!uartInitialized[inst])
+        return;
+
+#if USE_CHIBIOS
+    if (uartMode[inst] == UART_MODE_IRQ) {
+        while (uartIrq[inst].tx.head != uartIrq[inst].tx.tail)
+            chThdSleepMilliseconds(1);
+    }
+#endif
+    while (!(UART_LSR(base) & UART_LSR_TXSRE))
+        ;
+}
+
 int uartWrite(uint32_t inst, uint8_t *data, uint32_t len)
 {
     uint32_t base = inst2Base[inst];
@@ -207,10 +780,17 @@ int uartWrite(uint32_t inst, uint8_t *data, uint32_t len)
     if (!uartInitialized[inst])
         return 0;
 
+#if USE_CHIBIOS
+    if (uartMode[inst] == UART_MODE_IRQ)
+        return uartIrqWrite(inst, data, len);
+    if (uartMode[inst] == UART_MODE_DMA)
+        return uartDmaWrite(inst, data, len);
+#endif
+
     for (txLen = 0; txLen < len; txLen++) {
         uint32_t retry = 1000;
-        /* Wait for TXFIFO to be empty */
-        while (!(UART_LSR(base) & UART_LSR_TXSRE) && --retry)
+        /* Wait for room in the TXFIFO */
+        while ((UART_SSR(base) & UART_SSR_TXFIFOFULL) && --retry)
             ;
 
         if (retry)
@@ -230,6 +810,13 @@ int uartRead(uint32_t inst, uint8_t *data, uint32_t len)
     if (!uartInitialized[inst])
         return 0;
 
+#if USE_CHIBIOS
+    if (uartMode[inst] == UART_MODE_IRQ)
+        return uartIrqRead(inst, data, len);
+    if (uartMode[inst] == UART_MODE_DMA)
+        return uartDmaRead(inst, data, len);
+#endif
+
     for (rxLen = 0; rxLen < len; rxLen++) {
         uint32_t retry = 1000;
         /* Wait for RXFIFO to have data */
@@ -252,6 +839,20 @@ void uartFlush(uint32_t inst, bool32_t txFifo)
     if (!uartInitialized[inst])
         return;
 
+#if USE_CHIBIOS
+    if (uartMode[inst] == UART_MODE_IRQ) {
+        /* Steps on the other side's index, keep the ISR out */
+        chSysLock();
+        if (txFifo)
+            uartIrq[inst].tx.tail = uartIrq[inst].tx.head;
+        else
+            uartIrq[inst].rx.tail = uartIrq[inst].rx.head;
+        chSysUnlock();
+    }
+    if (uartMode[inst] == UART_MODE_DMA && !txFifo)
+        uartDma[inst].rxCount = uartDmaRxHead(&uartDma[inst]);
+#endif
+
     if (txFifo)
         UART_FCR(base) |= UART_FCR_TX_FIFO_CLEAR;
     else
@@ -0,0 +1,110 @@
+/*******************************************************************************
+ *
+ * vfp.c
+ *
+ * Lazy VFP/NEON context switching. The register file belongs to one thread
+ * at a time, the owner. FPEXC.EN is only set while the owner runs, so any
+ * other thread's first floating point instruction traps to _undefined_eh,
+ * which calls vfpTrap() to save the owner's registers, load the new
+ * thread's and hand it ownership before retrying the instruction.
+ *
+ * Threads that never touch the FPU cost one compare per switch. Only
+ * threads from vfpThdCreateStatic() have somewhere to keep the registers,
+ * floating point in any other thread is a fault like any other undefined
+ * instruction. ISRs must not use it at all, they would run on the
+ * interrupted owner's registers.
+ *
+ * Copyright (C) 2013 Paul Quevedo
+ *
+ * This program is free software.  It comes without any warranty, to the extent
+ * permitted by applicable law.  You can redistribute it and/or modify it under
+ * the terms of the WTF Public License (WTFPL), Version 2, as published by
+ * Sam Hocevar.  See http://sam.zoy.org/wtfpl/COPYING for more details.
+ *
+ *******************************************************************************/
+#include <stdint.h>
+#include <string.h>
+#include "arm/asm.h"
+
+#include "ch.h"
+
+#include "globalDefs.h"
+#include "hardware.h"
+#include "vfp.h"
+
+static Thread *vfpOwner;    /* Whose registers are in the VFP */
+
+void vfpInit(void)
+{
+    vfpOwner = NULL;
+    _vfp_init();
+}
+
+/*
+ * vfpThdCreateStatic()
+ *
+ * chThdCreateStatic() for a thread that may use the FPU. wsp is a
+ * VFP_WORKING_AREA(), its top holds the thread's saved VFP registers.
+ */
+Thread *vfpThdCreateStatic(void *wsp, size_t size, tprio_t prio,
+                           tfunc_t pf, void *arg)
+{
+    size_t stackSize = size - STACK_ALIGN(sizeof(vfpContext_t));
+    vfpContext_t *ctx = (vfpContext_t *)((uint8_t *)wsp + stackSize);
+    Thread *tp;
+
+    memset(ctx, 0, sizeof(*ctx));   /* FPSCR defaults, round to nearest */
+
+    chSysLock();
+    tp = chThdCreateI(wsp, stackSize, prio, pf, arg);
+    tp->p_vfp = ctx;
+    chSchWakeupS(tp, RDY_OK);
+    chSysUnlock();
+
+    return tp;
+}
+
+/*
+ * vfpSwitch()
+ *
+ * THREAD_CONTEXT_SWITCH_HOOK, kernel locked. Nothing to do until some
+ * thread has used the FPU.
+ */
+void vfpSwitch(Thread *ntp)
+{
+    if (vfpOwner != NULL)
+        _vfp_enable(ntp == vfpOwner);
+}
+
+/* THREAD_EXT_EXIT_HOOK, the owner's registers die with it */
+void vfpThreadExit(Thread *tp)
+{
+    if (tp == vfpOwner) {
+        vfpOwner = NULL;
+        _vfp_enable(FALSE);
+    }
+}
+
+/*
+ * vfpTrap()
+ *
+ * Called by _undefined_eh in MODE_UND, IRQs masked.
+ *
+ * RETURNS: OK to retry the instruction, ERROR if it wasn't an FPU
+ *          instruction from a thread entitled to one
+ */
+int vfpTrap(void)
+{
+    Thread *tp = currp;
+
+    if (hwInIsr() || tp->p_vfp == NULL || tp == vfpOwner)
+        return ERROR;   /* EN was already set for the owner, not ours */
+
+    _vfp_enable(TRUE);
+    if (vfpOwner != NULL)
+        _vfp_save(vfpOwner->p_vfp);
+    _vfp_restore(tp->p_vfp);
+    vfpOwner = tp;
+
+    return OK;
+}
@@ -0,0 +1,42 @@
+/*******************************************************************************
+ *
+ * vfp.h
+ *
+ * Lazy VFP/NEON context switching. Included by chconf.h for the Thread
+ * fields and hooks, so no kernel headers in here.
+ *
+ * Copyright (C) 2013 Paul Quevedo
+ *
+ * This program is free software.  It comes without any warranty, to the extent
+ * permitted by applicable law.  You can redistribute it and/or modify it under
+ * the terms of the WTF Public License (WTFPL), Version 2, as published by
+ * Sam Hocevar.  See http://sam.zoy.org/wtfpl/COPYING for more details.
+ *
+ *******************************************************************************/
+#ifndef __VFP_H__
+#define __VFP_H__
+#include <stdint.h>
+#include <stddef.h>
+
+typedef struct vfpContext {
+    uint64_t d[32];
+    uint32_t fpscr;
+} vfpContext_t;
+
+/* Working area for vfpThdCreateStatic(), the context sits at the top */
+#define VFP_THD_WA_SIZE(n)                                                  \
+        (THD_WA_SIZE(n) + STACK_ALIGN(sizeof(vfpContext_t)))
+#define VFP_WORKING_AREA(s, n)                                              \
+        stkalign_t s[VFP_THD_WA_SIZE(n) / sizeof(stkalign_t)]
+
+struct Thread;
+
+extern void vfpInit(void);
+extern struct Thread *vfpThdCreateStatic(void *wsp, size_t size, uint32_t prio,
+                                         int32_t (*pf)(void *), void *arg);
+
+/* Kernel hooks and the undefined instruction trap (start.S) */
+extern void vfpSwitch(struct Thread *ntp);
+extern void vfpThreadExit(struct Thread *tp);
+extern int  vfpTrap(void);
+#endif
@@ -0,0 +1,22 @@
+/*******************************************************************************
+ *
+ * wfi.h
+ *
+ * Board hook for the ChibiOS idle thread, included by chcore.h when
+ * ARM_ENABLE_WFI_IDLE is set in chconf.h. No kernel headers in here.
+ *
+ * Copyright (C) 2013 Paul Quevedo
+ *
+ * This program is free software.  It comes without any warranty, to the extent
+ * permitted by applicable law.  You can redistribute it and/or modify it under
+ * the terms of the WTF Public License (WTFPL), Version 2, as published by
+ * Sam Hocevar.  See http://sam.zoy.org/wtfpl/COPYING for more details.
+ *
+ *******************************************************************************/
+#ifndef __WFI_H__
+#define __WFI_H__
+
+extern void systickIdle(void);  /* hardware.c */
+
+#define port_wait_for_interrupt() systickIdle()
+#endif